@@ -1,13 +1,15 @@
 #include "ClauseList.h"
 #include "util.h"
 #include <map>
+#include <algorithm>
 
 namespace AllSAT {
     const int CL_VERBOSE = 8;
 
 
     ClauseList::ClauseList()
-        : verbose(0)
+        : _stamp(0)
+        , verbose(0)
     {
         lengths.push_back(0);
     }
@@ -110,6 +112,19 @@ namespace AllSAT {
         return out;
     }
 
+    void ClauseList::_nextStamp()
+    {
+        _rename.resize(nVars());
+        _rename_stamp.resize(nVars(), 0);
+        _sat_stamp.resize(numClauses(), 0);
+
+        if(++_stamp == 0) {
+            std::fill(_rename_stamp.begin(), _rename_stamp.end(), 0);
+            std::fill(_sat_stamp.begin(), _sat_stamp.end(), 0);
+            _stamp = 1;
+        }
+    }
+
     int ClauseList::addRewrittenClauses(
         const std::vector<sat_n::lbool>& assumps, 
         const std::vector<bool>& norewriteVarFlags,
@@ -117,73 +132,76 @@ namespace AllSAT {
     {
         int cnt = 0;
         using namespace sat_n;
-        std::map<Lit, Lit> rewrites;
+
+        _nextStamp();
+
+        // mark the clauses satisfied by the assignment, using the watches
+        // of the true literals.
+        for(int v=0; v < nVars() && v < (int) assumps.size(); v++) {
+            sat_n::lbool val = assumps[v];
+            if(val.isUndef()) continue;
+
+            Lit l = val.getBool() ? mkLit(v) : ~mkLit(v);
+            const std::vector<int>& ws = watches[toInt(l)];
+            for(unsigned j=0; j != ws.size(); j++) {
+                _sat_stamp[ws[j]] = _stamp;
+            }
+        }
 
         for(unsigned i=0; i != numClauses(); i++) {
+            if(_sat_stamp[i] == _stamp) {
+                if(verbose) {
+                    dump_clause(std::cout << "skipping satisfied clause: ", i) << std::endl;
+                }
+                continue;
+            }
+
             int len = clauseLen(i);
             assert(len > 0);
-            vec_lit_t newClause;
+            _new_clause.clear();
 
             if(verbose) {
                 dump_clause(std::cout << "original clause: ", i)  << std::endl;
             }
 
-            Lit sat_lit;
-            bool sat = false;
             for(int j=0; j != len; j++) {
                 Lit l_ij = clauseLit(i, j);
                 Var v_ij = var(l_ij);
                 assert((int) v_ij < (int) assumps.size());
                 sat_n::lbool val_ij = assumps[v_ij];
-                // the variable is not defined to be either true or false.
-                if(val_ij.isUndef()) {
-                    assert(v_ij < norewriteVarFlags.size());
-                    // if it is an existentially quantified variable,
-                    // then we don't rewrite it. 
-                    if(norewriteVarFlags[v_ij]) {
-                        newClause.push(l_ij);
-                    } else {
-                        // otherwise we need to introduce new variables
-                        // for these "internal" vars which are from the
-                        // second level of existential quantification.
-                        if(rewrites.find(l_ij) == rewrites.end()) {
-                            Var new_var = S.newVar();
+                // false literals are dropped; true ones can't occur here.
+                if(val_ij.isDef()) {
+                    assert((!val_ij.getBool() && sign(l_ij) == 0) ||
+                           (val_ij.getBool() && sign(l_ij) == 1));
+                    continue;
+                }
 
-                            Lit new_l_ij = mkLit(new_var);
-                            rewrites[mkLit(var(l_ij))] = new_l_ij;
-                            rewrites[~mkLit(var(l_ij))] = ~new_l_ij;
-                        }
-                        newClause.push(rewrites[l_ij]);
-                    }
-                } else  {
-                    assert(val_ij.isDef());
-                    sat = (val_ij.getBool() && sign(l_ij) == 0) ||
-                          (!val_ij.getBool() && sign(l_ij) == 1);
-                    bool unsat = (!val_ij.getBool() && sign(l_ij) == 0) ||
-                                  (val_ij.getBool() && sign(l_ij) == 1);
-                    if(sat) {
-                        sat_lit = l_ij;
-                        break;
-                    } else {
-                        assert(unsat);
+                assert(v_ij < norewriteVarFlags.size());
+                // if it is an existentially quantified variable,
+                // then we don't rewrite it. 
+                if(norewriteVarFlags[v_ij]) {
+                    _new_clause.push(l_ij);
+                } else {
+                    // otherwise we need to introduce new variables
+                    // for these "internal" vars which are from the
+                    // second level of existential quantification.
+                    if(_rename_stamp[v_ij] != _stamp) {
+                        _rename[v_ij] = mkLit(S.newVar());
+                        _rename_stamp[v_ij] = _stamp;
                     }
+                    _new_clause.push(sign(l_ij) ? ~_rename[v_ij] : _rename[v_ij]);
                 }
             }
-            if(sat) {
-                if(verbose) {
-                    using namespace ckt_n;
-                    std::cout << "skipping satisfied clause. lit: " << sat_lit << std::endl;
-                }
-                continue;
-            }
 
-            // FIXME: might need to remove this assertion if formulas are UNSAT?
-            assert(newClause.size() > 0);
+            // the clause is empty if the assignment itself is inconsistent,
+            // e.g., if an output observed from a noisy oracle contradicts
+            // the propagated constants; the empty clause then makes S UNSAT,
+            // just as the fully rewritten clauses would.
             if(verbose) {
                 using namespace ckt_n;
-                ckt_n::dump_clause(std::cout << "adding duplicate clause: ", newClause) << std::endl;
+                ckt_n::dump_clause(std::cout << "adding duplicate clause: ", _new_clause) << std::endl;
             }
-            S.addClause(newClause);
+            S.addClause(_new_clause);
             cnt += 1;
         }
         return cnt;
@@ -19,6 +19,16 @@ namespace AllSAT {
         std::vector<sat_n::Lit> _temp_clause;
         std::vector< std::vector<int> > watches;
 
+        // state reused by addRewrittenClauses. an entry of _rename (per
+        // variable) or of _sat_stamp (per clause) is only valid if its stamp
+        // equals _stamp, so nothing needs to be cleared between calls.
+        unsigned                _stamp;
+        std::vector<sat_n::Lit> _rename;
+        std::vector<unsigned>   _rename_stamp;
+        std::vector<unsigned>   _sat_stamp;
+        sat_n::vec_lit_t        _new_clause;
+        void _nextStamp();
+
         void _addClause(std::vector<sat_n::Lit>& xs, int size);
         void _addWatches(int index, std::vector<sat_n::Lit>& xs, int size);
         void _ensureLength(std::vector<sat_n::Lit>& xs, int size);
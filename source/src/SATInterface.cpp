@@ -1,9 +1,284 @@
 #include "SATInterface.h"
+#include <lglib.h>
+#include <stdlib.h>
 
 namespace sat_n {
-#ifndef CMSAT
     const lbool l_True(lbool::p_True);
     const lbool l_False(lbool::p_False);
     const lbool l_Undef(lbool::p_Undef);
-#endif
+
+    static backend_kind_t default_backend = LINGELING;
+
+    bool parseBackend(const std::string& name, backend_kind_t& kind)
+    {
+        if(name == "lingeling" || name == "lgl") {
+            kind = LINGELING;
+        } else if(name == "cmsat" || name == "cryptominisat") {
+            kind = CMSAT;
+        } else if(name == "minisat") {
+            kind = MINISAT;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    const char* backendName(backend_kind_t kind)
+    {
+        switch(kind) {
+            case LINGELING: return "lingeling";
+            case CMSAT:     return "cmsat";
+            case MINISAT:   return "minisat";
+        }
+        return "unknown";
+    }
+
+    void setDefaultBackend(backend_kind_t kind)
+    {
+        default_backend = kind;
+    }
+
+    backend_kind_t getDefaultBackend()
+    {
+        return default_backend;
+    }
+
+    backend_i* newBackend(backend_kind_t kind, unsigned seed)
+    {
+        switch(kind) {
+            case LINGELING: return newLingelingBackend(seed);
+            case CMSAT:     return newCMSatBackend(seed);
+            case MINISAT:   return newMinisatBackend(seed);
+        }
+        assert(false);
+        return NULL;
+    }
+
+    // lingeling.
+    class lgl_backend_t : public backend_i {
+        LGL* solver;
+        volatile int stop;
+
+        static int _terminate(void* state) {
+            return *(volatile int*)state;
+        }
+
+    public:
+        lgl_backend_t(unsigned seed) : stop(0) {
+            solver = lglinit();
+            if(seed) {
+                lglsetopt(solver, "seed", seed);
+            }
+            lglseterm(solver, _terminate, (void*)&stop);
+        }
+        ~lgl_backend_t() {
+            lglrelease(solver);
+        }
+
+        void add(const int* lits, size_t n) {
+            for(size_t i=0; i != n; i++) {
+                lgladd(solver, lits[i]);
+            }
+        }
+        void freeze(int lit) { lglfreeze(solver, lit); }
+        void assume(int lit) { lglassume(solver, lit); }
+        int solve() {
+            lglsetopt(solver, "dlim", -1);
+            return lglsat(solver);
+        }
+        void interrupt() { stop = 1; }
+        void clearInterrupt() { stop = 0; }
+        int deref(int lit) const { return lglderef(solver, lit); }
+        int nClauses() const { return lglnclauses(solver); }
+
+        int64_t getNumDecisions() const { return lglgetdecs(solver); }
+        int64_t getNumConflicts() const { return lglgetconfs(solver); }
+        int64_t getNumPropagations() const { return lglgetprops(solver); }
+    };
+
+    backend_i* newLingelingBackend(unsigned seed)
+    {
+        return new lgl_backend_t(seed);
+    }
+
+    // cryptominisat.
+    class cmsat_backend_t : public backend_i {
+        CMSat::Solver* S;
+        CMSat::vec<CMSat::Lit> clause;
+        CMSat::vec<CMSat::Lit> assumps;
+
+        CMSat::Lit _lit(int lit) {
+            CMSat::Var v = abs(lit) - 1;
+            while(S->nVars() <= v) {
+                S->newVar();
+            }
+            return CMSat::Lit(v, lit < 0);
+        }
+
+    public:
+        cmsat_backend_t(unsigned seed) {
+            CMSat::SolverConf conf;
+            conf.origSeed = seed;
+            S = new CMSat::Solver(conf);
+        }
+        ~cmsat_backend_t() {
+            delete S;
+        }
+
+        void add(const int* lits, size_t n) {
+            for(size_t i=0; i != n; i++) {
+                if(lits[i]) {
+                    clause.push(_lit(lits[i]));
+                } else {
+                    S->addClause(clause);
+                    clause.clear();
+                }
+            }
+        }
+        // cmsat doesn't eliminate variables across calls.
+        void freeze(int lit) { }
+        void assume(int lit) { assumps.push(_lit(lit)); }
+        int solve() {
+            CMSat::lbool result = S->solve(assumps);
+            assumps.clear();
+            if(result == CMSat::l_True) return 10;
+            else if(result == CMSat::l_False) return 20;
+            else return 0;
+        }
+        void interrupt() { S->needToInterrupt = true; }
+        void clearInterrupt() { S->needToInterrupt = false; }
+        int deref(int lit) const {
+            CMSat::Var v = abs(lit) - 1;
+            if(v >= S->model.size()) return 0;
+            CMSat::lbool val = S->model[v];
+            if(val == CMSat::l_Undef) return 0;
+            int r = (val == CMSat::l_True) ? 1 : -1;
+            return lit < 0 ? -r : r;
+        }
+        int nClauses() const { return S->nClauses(); }
+
+        int64_t getNumDecisions() const { return S->getNumDecisions(); }
+        // not exposed by cmsat.
+        int64_t getNumConflicts() const { return 0; }
+        int64_t getNumPropagations() const { return 0; }
+        bool hasSearchStats() const { return false; }
+    };
+
+    backend_i* newCMSatBackend(unsigned seed)
+    {
+        return new cmsat_backend_t(seed);
+    }
+
+    Solver::Solver()
+        : winner(NULL)
+        , winner_index(0)
+        , numVars(0)
+        , numFlushed(0)
+    {
+        kinds.push_back(default_backend);
+        members.push_back(newBackend(default_backend, 0));
+        winner = members[0];
+    }
+
+    Solver::~Solver()
+    {
+        for(unsigned i=0; i != members.size(); i++) {
+            delete members[i];
+        }
+    }
+
+    void Solver::setPortfolio(const std::vector<backend_kind_t>& ks)
+    {
+        // the members only receive the clauses added from now on.
+        assert(pending.size() == 0 && numFlushed == 0);
+        assert(ks.size() > 0);
+
+        for(unsigned i=0; i != members.size(); i++) {
+            delete members[i];
+        }
+        members.clear();
+        kinds = ks;
+        for(unsigned i=0; i != kinds.size(); i++) {
+            members.push_back(newBackend(kinds[i], i));
+        }
+        winner = members[0];
+        winner_index = 0;
+    }
+
+    void Solver::setPortfolio(unsigned n)
+    {
+        std::vector<backend_kind_t> ks(n > 0 ? n : 1, default_backend);
+        setPortfolio(ks);
+    }
+
+    bool Solver::_solve()
+    {
+        _flush();
+
+        int result = 0;
+        if(members.size() == 1) {
+            result = members[0]->solve();
+            winner_index = 0;
+        } else {
+            // run all members of the portfolio, the first one to finish
+            // interrupts the others.
+            int n = members.size();
+            for(int i=0; i < n; i++) {
+                members[i]->clearInterrupt();
+            }
+            #pragma omp parallel for num_threads(n) schedule(static, 1)
+            for(int i=0; i < n; i++) {
+                int r = members[i]->solve();
+                if(r != 0) {
+                    #pragma omp critical(sat_portfolio)
+                    if(result == 0) {
+                        result = r;
+                        winner_index = i;
+                        for(int j=0; j < n; j++) {
+                            if(j != i) members[j]->interrupt();
+                        }
+                    }
+                }
+            }
+        }
+        winner = members[winner_index];
+
+        if(result == 10) {
+            return true;
+        } else if(result == 20) {
+            return false;
+        } else {
+            assert(false);
+            return false;
+        }
+    }
+
+    int64_t Solver::getNumDecisions() const
+    {
+        int64_t n = 0;
+        for(unsigned i=0; i != members.size(); i++) n += members[i]->getNumDecisions();
+        return n;
+    }
+
+    int64_t Solver::getNumConflicts() const
+    {
+        int64_t n = 0;
+        for(unsigned i=0; i != members.size(); i++) n += members[i]->getNumConflicts();
+        return n;
+    }
+
+    int64_t Solver::getNumPropagations() const
+    {
+        int64_t n = 0;
+        for(unsigned i=0; i != members.size(); i++) n += members[i]->getNumPropagations();
+        return n;
+    }
+
+    bool Solver::hasSearchStats() const
+    {
+        for(unsigned i=0; i != members.size(); i++) {
+            if(!members[i]->hasSearchStats()) return false;
+        }
+        return true;
+    }
 }
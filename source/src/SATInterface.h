@@ -2,126 +2,13 @@
 #define _SATINTERFACE_H_DEFINED_
 
 #include <stdint.h>
-#include <lglib.h>
+#include <vector>
+#include <string>
+#include <assert.h>
 #include <cmsat/Solver.h>
 
 namespace sat_n
 {
-//#define CMSAT
-#ifdef CMSAT
-    typedef CMSat::Var Var;
-    typedef CMSat::Lit Lit;
-    typedef CMSat::lbool lbool;
-    typedef CMSat::vec<Lit> vec_lit_t;
-    const CMSat::lbool l_True = CMSat::l_True;
-    const CMSat::lbool l_False = CMSat::l_False;
-    const CMSat::lbool l_Undef = CMSat::l_Undef;
-
-    inline Lit mkLit(Var vi) { 
-        return CMSat::Lit(vi, false);
-    }
-
-    inline Var var(Lit l) {
-        return l.var();
-    }
-
-    inline bool sign(Lit l) {
-        return l.sign();
-    }
-
-    inline uint32_t toInt(Lit l) {
-        return l.toInt();
-    }
-
-    //stupid sentinel function, I added to check if lingeling was being compiled.
-    //inline void dostuff() {
-    //    LGL* lgl = lglinit();
-    //    lglrelease(lgl);
-    //}
-
-    class Solver {
-        CMSat::Solver S;
-
-    public:
-        Solver() {}
-        ~Solver() {}
-
-        Var newVar() { return S.newVar(); }
-        int nVars() const { return S.nVars(); }
-        int nClauses() const { return S.nClauses(); }
-
-        // freeze a single literal.
-        void freeze(Lit l) { }
-        // freeze a vector of literals.
-        void freeze(const std::vector<Lit>& ys) { }
-        
-        bool addClause(const vec_lit_t& ps) {
-            vec_lit_t ps_copy(ps);
-            return S.addClause(ps_copy);
-        }
-        bool addClause(Lit x) { 
-            vec_lit_t vs;
-            vs.push(x);
-            return S.addClause(vs); 
-        }
-        bool addClause(Lit x, Lit y) { 
-            vec_lit_t vs;
-            vs.push(x);
-            vs.push(y);
-            return S.addClause(vs);
-        }
-        bool addClause(Lit x, Lit y, Lit z) {
-            vec_lit_t vs;
-            vs.push(x);
-            vs.push(y);
-            vs.push(z);
-            return S.addClause(vs);
-        }
-
-        lbool modelValue(Lit x) const {
-            return S.modelValue(x);
-        }
-        lbool modelValue(Var x) const {
-            return S.modelValue(mkLit(x));
-        }
-        bool solve() { 
-            lbool result = S.solve(); 
-            if(result.isDef()) {
-                return result.getBool();
-            } else {
-                assert(false);
-                return false;
-            }
-        }
-        bool solve(const vec_lit_t& assump) { 
-            lbool result = S.solve(assump); 
-            if(result.isDef()) {
-                return result.getBool();
-            } else {
-                assert(false);
-                return false;
-            }
-        }
-        bool solve(Lit x) { 
-            vec_lit_t assump;
-            assump.push(x);
-            lbool result = S.solve(assump); 
-            if(result.isDef()) {
-                return result.getBool();
-            } else {
-                assert(false);
-                return false;
-            }
-        }
-        void writeCNF(const std::string& filename) {
-            S.dumpOrigClauses(filename);
-        }
-        int64_t getNumDecisions() const {
-            return S.getNumDecisions();
-        }
-    };
-#else
-
     typedef CMSat::Var Var;
     typedef CMSat::Lit Lit;
     typedef CMSat::vec<Lit> vec_lit_t;
@@ -173,9 +60,64 @@ namespace sat_n
         return l.toInt();
     }
 
+    // the SAT solvers which can be used underneath Solver.
+    enum backend_kind_t { LINGELING, CMSAT, MINISAT };
+
+    // parse a backend name (lingeling, cmsat or minisat).
+    bool parseBackend(const std::string& name, backend_kind_t& kind);
+    const char* backendName(backend_kind_t kind);
+    // backend used by newly created solvers, lingeling by default.
+    void setDefaultBackend(backend_kind_t kind);
+    backend_kind_t getDefaultBackend();
+
+    // interface to the actual SAT solver. literals are in DIMACS form, i.e.
+    // variables start from 1 and negative numbers are negated literals.
+    struct backend_i {
+        virtual ~backend_i() {}
+
+        // add zero-terminated clauses.
+        virtual void add(const int* lits, size_t n) = 0;
+        virtual void freeze(int lit) = 0;
+        // assumptions hold for the next call to solve only.
+        virtual void assume(int lit) = 0;
+        // returns 10 if satisfiable, 20 if unsatisfiable and 0 if
+        // interrupted.
+        virtual int solve() = 0;
+        // may be called from another thread while solving.
+        virtual void interrupt() = 0;
+        virtual void clearInterrupt() = 0;
+        // value of a literal in the last model: 1, -1 or 0 if unknown.
+        virtual int deref(int lit) const = 0;
+        virtual int nClauses() const = 0;
+
+        virtual int64_t getNumDecisions() const = 0;
+        virtual int64_t getNumConflicts() const = 0;
+        virtual int64_t getNumPropagations() const = 0;
+        // false if the conflict and propagation counts aren't available.
+        virtual bool hasSearchStats() const { return true; }
+    };
+
+    // create a backend; the seed is used to diversify portfolio members.
+    backend_i* newBackend(backend_kind_t kind, unsigned seed);
+    backend_i* newLingelingBackend(unsigned seed);
+    backend_i* newCMSatBackend(unsigned seed);
+    backend_i* newMinisatBackend(unsigned seed);
+
+    // The solver collects the clauses in a buffer, which is handed to the
+    // backend(s) before they are needed, so that adding clauses involves no
+    // virtual calls.
     class Solver {
-        LGL* solver;
+        // the first entry is the main backend; any further entries are the
+        // members of the portfolio, see setPortfolio.
+        std::vector<backend_i*> members;
+        std::vector<backend_kind_t> kinds;
+        // the backend which found the last answer, used for the model.
+        backend_i* winner;
+        unsigned winner_index;
         uint32_t numVars;
+        // clauses not yet handed to the backends.
+        mutable std::vector<int> pending;
+        mutable int64_t numFlushed;
 
         static int translate(Lit l) {
             int v = (var(l) + 1);
@@ -185,33 +127,43 @@ namespace sat_n
             assert(v >= 0);
             return v+1;
         }
-        bool _solve() { 
-            lglsetopt(solver, "dlim", -1);
-            int result = lglsat(solver);
-            if(result == LGL_SATISFIABLE) {
-                return true;
-            } else if(result == LGL_UNSATISFIABLE) {
-                return false;
-            } else {
-                assert(false);
-                return false;
+        void _flush() const {
+            if(pending.size()) {
+                for(unsigned i=0; i != members.size(); i++) {
+                    members[i]->add(&pending[0], pending.size());
+                }
+                numFlushed += pending.size();
+                pending.clear();
             }
         }
+        void _assume(int lit) {
+            for(unsigned i=0; i != members.size(); i++) {
+                members[i]->assume(lit);
+            }
+        }
+        bool _solve();
 
     public:
         // Constructor.
-        Solver() { 
-            solver = lglinit(); 
-            numVars = 0; 
-        }
+        Solver();
         // Destrucutor.
-        ~Solver() { 
-            lglrelease(solver); 
-        }
+        ~Solver();
+
+        // Run several backends in parallel and take the answer of the first
+        // one; member i is of kind kinds[i] and uses seed i. This must be
+        // called before any clauses are added.
+        void setPortfolio(const std::vector<backend_kind_t>& kinds);
+        // portfolio of n backends of the default kind.
+        void setPortfolio(unsigned n);
+        // Number of backends run in parallel.
+        unsigned portfolioSize() const { return members.size(); }
+        // Index of the backend which found the last answer.
+        unsigned portfolioWinner() const { return winner_index; }
+        backend_kind_t backendKind(unsigned i) const { return kinds[i]; }
 
         // Create a new variable.
         Var newVar() { 
-            // No need to create vars in lgl, just do our own bookkeeping.
+            // No need to create vars in the backend, just do our own bookkeeping.
             Var v = numVars;
             numVars += 1;
             return v;
@@ -219,67 +171,70 @@ namespace sat_n
         // Number of variables created so far.
         int nVars() const { return numVars; }
         // Number of clauses added so far.
-        int nClauses() const { return lglnclauses(solver); }
+        int nClauses() const { 
+            _flush();
+            return members[0]->nClauses(); 
+        }
 
         // freeze a single literal.
         void freeze(Lit l) {
-            lglfreeze(solver, translate(l));
+            _flush();
+            for(unsigned j=0; j != members.size(); j++) {
+                members[j]->freeze(translate(l));
+            }
         }
 
         // freeze a vector of literals.
         void freeze(const std::vector<Lit>& ys) {
-            for(unsigned i=0; i != ys.size(); i++) {
-                lglfreeze(solver, translate(ys[i]));
+            _flush();
+            for(unsigned j=0; j != members.size(); j++) {
+                for(unsigned i=0; i != ys.size(); i++) {
+                    members[j]->freeze(translate(ys[i]));
+                }
             }
         }
 
         // Add a vector of literals as a clause.
         bool addClause(const vec_lit_t& ps) {
             for(unsigned i=0; i != ps.size(); i++) {
-                lgladd(solver, translate(ps[i]));
+                pending.push_back(translate(ps[i]));
             }
-            lgladd(solver, 0);
+            pending.push_back(0);
             return true;
         }
 
         // Add a single literal as a clause.
         bool addClause(Lit x) { 
-            lgladd(solver, translate(x));
-            lgladd(solver, 0);
+            pending.push_back(translate(x));
+            pending.push_back(0);
             return true;
         }
 
         // Add a clause with two literals.
         bool addClause(Lit x, Lit y) { 
-            lgladd(solver, translate(x));
-            lgladd(solver, translate(y));
-            lgladd(solver, 0);
+            pending.push_back(translate(x));
+            pending.push_back(translate(y));
+            pending.push_back(0);
             return true;
         }
 
         // Add a clause with three literals.
         bool addClause(Lit x, Lit y, Lit z) {
-            lgladd(solver, translate(x));
-            lgladd(solver, translate(y));
-            lgladd(solver, translate(z));
-            lgladd(solver, 0);
+            pending.push_back(translate(x));
+            pending.push_back(translate(y));
+            pending.push_back(translate(z));
+            pending.push_back(0);
             return true;
         }
 
         // Return the value of a literal.
         lbool modelValue(Lit x) const {
-            int v = lglderef(solver, translate(x));
-            if(v == 1) return l_True;
-            else if(v == -1) return l_False;
-            else return l_Undef;
+            return lbool(winner->deref(translate(x)));
         }
 
         // Return the value of a variable.
         lbool modelValue(Var x) const {
-            int v = lglderef(solver, translate(x));
-            if(v == 1) return l_True;
-            else if(v == -1) return l_False;
-            else return l_Undef;
+            return lbool(winner->deref(translate(x)));
         }
 
         // Solve without any assumptions.
@@ -288,24 +243,28 @@ namespace sat_n
         }
 
         bool solve(const vec_lit_t& assump) { 
+            _flush();
             for(unsigned i=0; i != assump.size(); i++) {
-                lglassume(solver, translate(assump[i]));
+                _assume(translate(assump[i]));
             }
             return _solve();
         }
         bool solve(Lit x) { 
-            lglassume(solver, translate(x));
+            _flush();
+            _assume(translate(x));
             return _solve();
         }
 
         void writeCNF(const std::string& filename) {
             // FIXME.
         }
-        int64_t getNumDecisions() const {
-            return lglgetdecs(solver);
-        }
+        // statistics are summed over all members of the portfolio.
+        int64_t getNumDecisions() const;
+        int64_t getNumConflicts() const;
+        int64_t getNumPropagations() const;
+        // whether all members count conflicts and propagations.
+        bool hasSearchStats() const;
     };
-#endif
 }
 
 #endif
@@ -0,0 +1,76 @@
+// The minisat backend lives in a file of its own since minisat defines
+// l_True and friends as macros.
+#include "SATInterface.h"
+#include <stdlib.h>
+#include "core/Solver.h"
+
+// outside of sat_n, so that the l_True macros refer to minisat's lbool.
+namespace {
+    using namespace Minisat;
+
+    class minisat_backend_t : public sat_n::backend_i {
+        Minisat::Solver S;
+        Minisat::vec<Minisat::Lit> clause;
+        Minisat::vec<Minisat::Lit> assumps;
+
+        Minisat::Lit _lit(int lit) {
+            Minisat::Var v = abs(lit) - 1;
+            while(S.nVars() <= v) {
+                S.newVar();
+            }
+            return Minisat::mkLit(v, lit < 0);
+        }
+
+    public:
+        minisat_backend_t(unsigned seed) {
+            // other portfolio members start from random activities.
+            if(seed) {
+                S.random_seed += seed;
+                S.rnd_init_act = true;
+            }
+        }
+
+        void add(const int* lits, size_t n) {
+            for(size_t i=0; i != n; i++) {
+                if(lits[i]) {
+                    clause.push(_lit(lits[i]));
+                } else {
+                    S.addClause(clause);
+                    clause.clear();
+                }
+            }
+        }
+        // minisat's core solver doesn't eliminate variables.
+        void freeze(int lit) { }
+        void assume(int lit) { assumps.push(_lit(lit)); }
+        int solve() {
+            Minisat::lbool result = S.solveLimited(assumps);
+            assumps.clear();
+            if(result == l_True) return 10;
+            else if(result == l_False) return 20;
+            else return 0;
+        }
+        void interrupt() { S.interrupt(); }
+        void clearInterrupt() { S.clearInterrupt(); }
+        int deref(int lit) const {
+            Minisat::Var v = abs(lit) - 1;
+            if(v >= S.model.size()) return 0;
+            Minisat::lbool val = S.model[v];
+            if(val == l_Undef) return 0;
+            int r = (val == l_True) ? 1 : -1;
+            return lit < 0 ? -r : r;
+        }
+        int nClauses() const { return S.nClauses(); }
+
+        int64_t getNumDecisions() const { return S.decisions; }
+        int64_t getNumConflicts() const { return S.conflicts; }
+        int64_t getNumPropagations() const { return S.propagations; }
+    };
+}
+
+namespace sat_n {
+    backend_i* newMinisatBackend(unsigned seed)
+    {
+        return new minisat_backend_t(seed);
+    }
+}
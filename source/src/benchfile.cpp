@@ -0,0 +1,195 @@
+#include "benchfile.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <assert.h>
+
+namespace ckt_n {
+
+    namespace {
+        enum token_t { T_EOF, T_INPUT, T_OUTPUT, T_LPAREN, T_RPAREN, T_COMMA, T_EQUALS, T_ID, T_ERROR };
+
+        // same tokens as the old flex scanner: '#' starts a comment, blanks,
+        // tabs, '+' and '\r' are ignored, and INPUT/OUTPUT are keywords.
+        struct scanner_t {
+            const char* pos;
+            const char* end;
+            unsigned    line;
+
+            scanner_t(const char* data, size_t size)
+                : pos(data)
+                , end(data + size)
+                , line(1)
+            {
+            }
+
+            static bool is_id_start(char c) {
+                return c == '_' || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+            }
+            static bool is_id_char(char c) {
+                return is_id_start(c) || (c >= '0' && c <= '9') || c == '$';
+            }
+
+            token_t next(bench_file_t::span_t& id) {
+                while(pos != end) {
+                    char c = *pos;
+                    if(c == ' ' || c == '\t' || c == '+' || c == '\r') {
+                        pos++;
+                    } else if(c == '\n') {
+                        line++;
+                        pos++;
+                    } else if(c == '#') {
+                        while(pos != end && *pos != '\n') pos++;
+                    } else {
+                        break;
+                    }
+                }
+                if(pos == end) return T_EOF;
+
+                char c = *pos;
+                if(is_id_start(c)) {
+                    const char* start = pos;
+                    while(pos != end && is_id_char(*pos)) pos++;
+                    id.ptr = start;
+                    id.len = pos - start;
+                    if(id.len == 5 && memcmp(start, "INPUT", 5) == 0) return T_INPUT;
+                    if(id.len == 6 && memcmp(start, "OUTPUT", 6) == 0) return T_OUTPUT;
+                    return T_ID;
+                }
+                pos++;
+                switch(c) {
+                    case '(': return T_LPAREN;
+                    case ')': return T_RPAREN;
+                    case ',': return T_COMMA;
+                    case '=': return T_EQUALS;
+                    default:  return T_ERROR;
+                }
+            }
+        };
+    }
+
+    bench_file_t::bench_file_t()
+        : map_addr(NULL)
+        , map_size(0)
+    {
+    }
+
+    bench_file_t::~bench_file_t()
+    {
+        close();
+    }
+
+    void bench_file_t::close()
+    {
+        if(map_addr != NULL) {
+            munmap(map_addr, map_size);
+            map_addr = NULL;
+            map_size = 0;
+        }
+        decls.clear();
+        gate_inputs.clear();
+    }
+
+    bool bench_file_t::_error(unsigned line, const std::string& msg) const
+    {
+        std::cerr << filename << ":" << line << ": " << msg << std::endl;
+        return false;
+    }
+
+    bool bench_file_t::read(const std::string& fname)
+    {
+        close();
+        filename = fname;
+
+        int fd = open(fname.c_str(), O_RDONLY);
+        if(fd == -1) {
+            perror(fname.c_str());
+            return false;
+        }
+        struct stat st;
+        if(fstat(fd, &st) != 0) {
+            perror(fname.c_str());
+            ::close(fd);
+            return false;
+        }
+
+        // an empty file is a valid (empty) netlist, but can't be mapped.
+        if(st.st_size == 0) {
+            ::close(fd);
+            return true;
+        }
+
+        void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if(addr == MAP_FAILED) {
+            perror(fname.c_str());
+            return false;
+        }
+        madvise(addr, st.st_size, MADV_SEQUENTIAL);
+        map_addr = addr;
+        map_size = st.st_size;
+
+        return parse((const char*) map_addr, map_size);
+    }
+
+    bool bench_file_t::parse(const char* data, size_t size)
+    {
+        decls.clear();
+        gate_inputs.clear();
+
+        scanner_t sc(data, size);
+        span_t id;
+        token_t t;
+        while((t = sc.next(id)) != T_EOF) {
+            decl_t d;
+            d.line = sc.line;
+            d.inputs_begin = d.inputs_end = gate_inputs.size();
+            d.function.ptr = NULL;
+            d.function.len = 0;
+
+            if(t == T_INPUT || t == T_OUTPUT) {
+                d.type = (t == T_INPUT) ? decl_t::INPUT : decl_t::OUTPUT;
+                if(sc.next(id) != T_LPAREN) return _error(sc.line, "syntax error, expected '('");
+                if(sc.next(d.name) != T_ID) return _error(sc.line, "syntax error, expected a name");
+                if(sc.next(id) != T_RPAREN) return _error(sc.line, "syntax error, expected ')'");
+            } else if(t == T_ID) {
+                d.type = decl_t::GATE;
+                d.name = id;
+                if(sc.next(id) != T_EQUALS) return _error(sc.line, "syntax error, expected '='");
+                if(sc.next(d.function) != T_ID) return _error(sc.line, "syntax error, expected a gate function");
+                if(sc.next(id) != T_LPAREN) return _error(sc.line, "syntax error, expected '('");
+                do {
+                    if(sc.next(id) != T_ID) return _error(sc.line, "syntax error, expected a name");
+                    gate_inputs.push_back(id);
+                } while((t = sc.next(id)) == T_COMMA);
+                if(t != T_RPAREN) return _error(sc.line, "syntax error, expected ',' or ')'");
+                d.inputs_end = gate_inputs.size();
+            } else {
+                return _error(sc.line, "syntax error");
+            }
+            decls.push_back(d);
+        }
+        return true;
+    }
+
+    void bench_file_t::print_decl(std::ostream& out, const decl_t& d) const
+    {
+        if(d.type == decl_t::INPUT) {
+            out << "INPUT(" << d.name.str() << ")";
+        } else if(d.type == decl_t::OUTPUT) {
+            out << "OUTPUT(" << d.name.str() << ")";
+        } else {
+            out << d.name.str() << " = " << d.function.str() << "(";
+            for(unsigned i=d.inputs_begin; i != d.inputs_end; i++) {
+                out << gate_inputs[i].str();
+                if(i+1 != d.inputs_end) {
+                    out << ", ";
+                }
+            }
+            out << ")";
+        }
+    }
+}
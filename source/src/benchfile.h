@@ -0,0 +1,77 @@
+#ifndef _BENCHFILE_H_DEFINED_
+#define _BENCHFILE_H_DEFINED_
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <string.h>
+
+namespace ckt_n {
+
+    // Reader for .bench netlists.
+    //
+    // The file is memory-mapped and scanned in place. The identifiers are
+    // kept as spans of the mapped file and the declarations as flat arrays
+    // of spans, so nothing is copied until ckt_t creates the nodes. There is
+    // no global state, so different files can be read concurrently from
+    // different threads. The spans are valid until the file is closed.
+    struct bench_file_t {
+        struct span_t {
+            const char* ptr;
+            unsigned    len;
+
+            std::string str() const { return std::string(ptr, len); }
+            bool operator==(const span_t& other) const {
+                return len == other.len && memcmp(ptr, other.ptr, len) == 0;
+            }
+        };
+
+        // FNV-1a, for hash maps keyed by spans.
+        struct span_hash_t {
+            size_t operator()(const span_t& s) const {
+                size_t h = 14695981039346656037ULL;
+                for(unsigned i=0; i != s.len; i++) {
+                    h = (h ^ (unsigned char) s.ptr[i]) * 1099511628211ULL;
+                }
+                return h;
+            }
+        };
+
+        struct decl_t {
+            enum { INPUT, OUTPUT, GATE } type;
+            span_t      name;
+            // gates only; the inputs are gate_inputs[inputs_begin, inputs_end).
+            span_t      function;
+            unsigned    inputs_begin, inputs_end;
+            unsigned    line;
+        };
+
+        std::string             filename;
+        std::vector<decl_t>     decls;
+        std::vector<span_t>     gate_inputs;
+
+        bench_file_t();
+        ~bench_file_t();
+
+        // map and scan a file. on errors, a message is printed to stderr
+        // and false is returned.
+        bool read(const std::string& fname);
+        // scan a buffer, which has to outlive the spans.
+        bool parse(const char* data, size_t size);
+        void close();
+
+        void print_decl(std::ostream& out, const decl_t& d) const;
+
+    private:
+        void*       map_addr;
+        size_t      map_size;
+
+        bool _error(unsigned line, const std::string& msg) const;
+
+        // not copyable, the spans point into the mapping.
+        bench_file_t(const bench_file_t&);
+        bench_file_t& operator=(const bench_file_t&);
+    };
+}
+
+#endif
@@ -0,0 +1,454 @@
+#include "bitsim.h"
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <math.h>
+
+namespace ckt_n {
+
+    void rng_t::seed_with(uint64_t seed)
+    {
+        for(unsigned i=0; i != 2; i++) {
+            seed += 0x9E3779B97F4A7C15ULL;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            s[i] = z ^ (z >> 31);
+        }
+        if(s[0] == 0 && s[1] == 0) s[0] = 1;
+    }
+
+    uint64_t rng_t::bernoulli(uint32_t thresh)
+    {
+        if(thresh == 0) return 0;
+        if(thresh >= PROB_ONE) return ~(uint64_t)0;
+
+        // process the bits of thresh starting with the least significant
+        // one: m = b ? (m | r) : (m & r) halves the probability of a set bit
+        // and adds b/2, so after the MSB it's exactly thresh / 2^PROB_BITS.
+        // the trailing zeros can be skipped as m & r stays zero.
+        uint64_t m = 0;
+        for(unsigned i = __builtin_ctz(thresh); i != PROB_BITS; i++) {
+            uint64_t r = next();
+            m = ((thresh >> i) & 1) ? (m | r) : (m & r);
+        }
+        return m;
+    }
+
+    uint32_t rng_t::threshold(double percent)
+    {
+        if(percent <= 0.0) return 0;
+        if(percent >= 100.0) return PROB_ONE;
+        return (uint32_t) floor(percent / 100.0 * PROB_ONE + 0.5);
+    }
+
+    uint64_t time_seed()
+    {
+        auto now = std::chrono::high_resolution_clock::now();
+        auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+        return (uint64_t) nanos;
+    }
+
+    bitsim_t::bitsim_t(ckt_t& c)
+        : ckt(c)
+        , stochastic(false)
+    {
+        const flatckt_t& flat = ckt.flat;
+        assert(flat.num_gates() == ckt.num_gates());
+        assert(flat.num_nodes() == ckt.num_nodes());
+
+        // the gates index into the CSR fan-in array of the flat circuit.
+        fanins = flat.fanins;
+
+        gates.resize(flat.num_gates());
+        gate_pos.assign(flat.num_nodes(), -1);
+        for(unsigned i=0; i != flat.gate_order.size(); i++) {
+            unsigned idx = flat.gate_order[i];
+            node_t* n = ckt.nodes[idx];
+            gate_t& g = gates[i];
+            gate_pos[idx] = i;
+
+            g.function = flat.functions[idx];
+            if(g.function == fct::UNDEF) {
+                std::cout << "ERROR: unsupported function for gate " << n->name << ": \"" << n->func << "\"" << std::endl;
+                exit(1);
+            }
+            g.out = idx;
+
+            g.fanin_begin = flat.fanin_begin[idx];
+            g.fanin_end = flat.fanin_begin[idx+1];
+            assert(g.fanin_end > g.fanin_begin);
+            assert(g.function != fct::MUX || n->num_inputs() == 3);
+
+            g.flip = rng_t::threshold(n->error_rate);
+
+            // the polymorphic functions are picked by a uniform draw over
+            // [0, 100), in the order they were declared; lanes falling past
+            // the last function keep the original one. this is mapped onto a
+            // sequence of conditional selections.
+            g.poly_begin = polys.size();
+            double mass = 100.0;
+            for(auto const& pf : n->polymorphic_fcts) {
+                if(pf.function != fct::INV && pf.function != fct::BUF && n->num_inputs() == 1) {
+                    std::cout << "ERROR: gate " << n->name << " cannot support the probabilistic function ";
+                    std::cout << pf.name << " as the underlying gate was original a \"" << n->func << "\" gate" << std::endl;
+                    exit(1);
+                }
+                if(pf.function == fct::UNDEF || pf.function == fct::MUX) {
+                    std::cout << "ERROR: unsupported function for gate " << n->name << ": \"" << pf.name << "\"" << std::endl;
+                    exit(1);
+                }
+
+                poly_t p;
+                p.function = pf.function;
+                p.select = (mass > 0.0) ? rng_t::threshold(100.0 * pf.probability / mass) : 0;
+                polys.push_back(p);
+                mass -= pf.probability;
+            }
+            g.poly_end = polys.size();
+
+            if(g.flip != 0 || g.poly_end != g.poly_begin) {
+                stochastic = true;
+            }
+        }
+
+        outputs = flat.outputs;
+    }
+
+    void bitsim_t::init_frame(frame_t& f, unsigned words) const
+    {
+        assert(words > 0);
+        f.words = words;
+        f.values.assign(ckt.num_nodes() * words, 0);
+        f.scratch.assign(2 * words, 0);
+    }
+
+    void bitsim_t::set_value(frame_t& f, unsigned idx, bool v) const
+    {
+        word_t w = v ? ~(word_t)0 : 0;
+        std::fill(f.values.begin() + idx * f.words, f.values.begin() + (idx+1) * f.words, w);
+    }
+
+    void bitsim_t::get_outputs(const frame_t& f, unsigned lane, std::vector<bool>& outs) const
+    {
+        outs.resize(outputs.size());
+        for(unsigned i=0; i != outputs.size(); i++) {
+            outs[i] = get_value(f, outputs[i], lane);
+        }
+    }
+
+    void bitsim_t::get_outputs(const frame_t& f, unsigned lane, word_t* outs) const
+    {
+        const unsigned w = lane / WORD_BITS;
+        const unsigned b = lane % WORD_BITS;
+        const unsigned n = (outputs.size() + WORD_BITS - 1) / WORD_BITS;
+
+        for(unsigned i=0; i != n; i++) {
+            outs[i] = 0;
+        }
+        for(unsigned i=0; i != outputs.size(); i++) {
+            word_t v = (f.values[outputs[i] * f.words + w] >> b) & 1;
+            outs[i / WORD_BITS] |= v << (i % WORD_BITS);
+        }
+    }
+
+    void bitsim_t::_apply(fct function, const gate_t& g, const frame_t& f, word_t* out) const
+    {
+        const unsigned words = f.words;
+        const word_t* vs = &f.values[0];
+        const word_t* a = vs + fanins[g.fanin_begin] * words;
+
+        switch(function) {
+            case fct::AND:
+            case fct::NAND:
+                for(unsigned w=0; w != words; w++) out[w] = a[w];
+                for(unsigned j=g.fanin_begin+1; j != g.fanin_end; j++) {
+                    const word_t* b = vs + fanins[j] * words;
+                    for(unsigned w=0; w != words; w++) out[w] &= b[w];
+                }
+                if(function == fct::NAND) {
+                    for(unsigned w=0; w != words; w++) out[w] = ~out[w];
+                }
+                break;
+            case fct::OR:
+            case fct::NOR:
+                for(unsigned w=0; w != words; w++) out[w] = a[w];
+                for(unsigned j=g.fanin_begin+1; j != g.fanin_end; j++) {
+                    const word_t* b = vs + fanins[j] * words;
+                    for(unsigned w=0; w != words; w++) out[w] |= b[w];
+                }
+                if(function == fct::NOR) {
+                    for(unsigned w=0; w != words; w++) out[w] = ~out[w];
+                }
+                break;
+            case fct::XOR:
+            case fct::XNOR:
+                for(unsigned w=0; w != words; w++) out[w] = a[w];
+                for(unsigned j=g.fanin_begin+1; j != g.fanin_end; j++) {
+                    const word_t* b = vs + fanins[j] * words;
+                    for(unsigned w=0; w != words; w++) out[w] ^= b[w];
+                }
+                if(function == fct::XNOR) {
+                    for(unsigned w=0; w != words; w++) out[w] = ~out[w];
+                }
+                break;
+            case fct::INV:
+                for(unsigned w=0; w != words; w++) out[w] = ~a[w];
+                break;
+            case fct::BUF:
+                for(unsigned w=0; w != words; w++) out[w] = a[w];
+                break;
+            case fct::MUX: {
+                // y = ~s*a + s*b, inputs are (s, a, b).
+                const word_t* x = vs + fanins[g.fanin_begin+1] * words;
+                const word_t* y = vs + fanins[g.fanin_begin+2] * words;
+                for(unsigned w=0; w != words; w++) out[w] = (~a[w] & x[w]) | (a[w] & y[w]);
+                break;
+            }
+            default:
+                assert(false);
+                break;
+        }
+    }
+
+    void bitsim_t::_apply_ternary(const gate_t& g, frame_t& val, frame_t& known) const
+    {
+        const unsigned words = val.words;
+        const word_t* vs = &val.values[0];
+        const word_t* ks = &known.values[0];
+        word_t* out_v = &val.values[g.out * words];
+        word_t* out_k = &known.values[g.out * words];
+
+        const unsigned a_idx = fanins[g.fanin_begin] * words;
+        const word_t* va = vs + a_idx;
+        const word_t* ka = ks + a_idx;
+
+        switch(g.function) {
+            case fct::AND:
+            case fct::NAND:
+            case fct::OR:
+            case fct::NOR: {
+                // ctrl: some input is known to be at the controlling value,
+                // all: all inputs are known to be at the other value.
+                const bool is_and = (g.function == fct::AND || g.function == fct::NAND);
+                for(unsigned w=0; w != words; w++) {
+                    word_t ctrl = 0, all = ~(word_t)0;
+                    for(unsigned j=g.fanin_begin; j != g.fanin_end; j++) {
+                        word_t v = vs[fanins[j] * words + w];
+                        word_t k = ks[fanins[j] * words + w];
+                        word_t nc = is_and ? (k & v) : (k & ~v);
+                        ctrl |= k & ~nc;
+                        all &= nc;
+                    }
+                    // the value is 1 for and if all are 1, for or if one is 1.
+                    word_t one = is_and ? all : ctrl;
+                    out_k[w] = ctrl | all;
+                    out_v[w] = one;
+                }
+                if(g.function == fct::NAND || g.function == fct::NOR) {
+                    for(unsigned w=0; w != words; w++) out_v[w] = ~out_v[w] & out_k[w];
+                }
+                break;
+            }
+            case fct::XOR:
+            case fct::XNOR:
+                for(unsigned w=0; w != words; w++) {
+                    word_t v = 0, k = ~(word_t)0;
+                    for(unsigned j=g.fanin_begin; j != g.fanin_end; j++) {
+                        v ^= vs[fanins[j] * words + w];
+                        k &= ks[fanins[j] * words + w];
+                    }
+                    if(g.function == fct::XNOR) v = ~v;
+                    out_k[w] = k;
+                    out_v[w] = v & k;
+                }
+                break;
+            case fct::INV:
+                for(unsigned w=0; w != words; w++) {
+                    out_k[w] = ka[w];
+                    out_v[w] = ~va[w] & ka[w];
+                }
+                break;
+            case fct::BUF:
+                for(unsigned w=0; w != words; w++) {
+                    out_k[w] = ka[w];
+                    out_v[w] = va[w];
+                }
+                break;
+            case fct::MUX: {
+                // inputs are (s, a, b); known if s is known and so is the
+                // selected input, or if a and b are known and equal.
+                const unsigned x_idx = fanins[g.fanin_begin+1] * words;
+                const unsigned y_idx = fanins[g.fanin_begin+2] * words;
+                for(unsigned w=0; w != words; w++) {
+                    word_t vx = vs[x_idx + w], kx = ks[x_idx + w];
+                    word_t vy = vs[y_idx + w], ky = ks[y_idx + w];
+                    word_t sel_x = ka[w] & ~va[w];
+                    word_t sel_y = ka[w] & va[w];
+                    word_t same = kx & ky & ~(vx ^ vy);
+                    out_k[w] = (sel_x & kx) | (sel_y & ky) | same;
+                    out_v[w] = ((sel_x & vx) | (sel_y & vy) | (same & vx)) & out_k[w];
+                }
+                break;
+            }
+            default:
+                assert(false);
+                break;
+        }
+    }
+
+    void bitsim_t::eval_ternary(frame_t& val, frame_t& known) const
+    {
+        assert(val.words == known.words);
+        assert(val.values.size() == ckt.num_nodes() * val.words);
+
+        for(unsigned i=0; i != gates.size(); i++) {
+            _apply_ternary(gates[i], val, known);
+        }
+    }
+
+    void bitsim_t::_override_ternary(unsigned idx, frame_t& val, frame_t& known, int x_idx, int inv_idx) const
+    {
+        const unsigned words = val.words;
+        word_t* v = &val.values[idx * words];
+        word_t* k = &known.values[idx * words];
+        if((int) idx == x_idx) {
+            for(unsigned w=0; w != words; w++) { v[w] = 0; k[w] = 0; }
+        } else if((int) idx == inv_idx) {
+            for(unsigned w=0; w != words; w++) v[w] = ~v[w] & k[w];
+        }
+    }
+
+    void bitsim_t::eval_ternary(frame_t& val, frame_t& known, int x_idx, int inv_idx) const
+    {
+        assert(val.words == known.words);
+        assert(val.values.size() == ckt.num_nodes() * val.words);
+
+        if(x_idx != -1 && gate_pos[x_idx] == -1) {
+            _override_ternary(x_idx, val, known, x_idx, inv_idx);
+        }
+        if(inv_idx != -1 && gate_pos[inv_idx] == -1) {
+            _override_ternary(inv_idx, val, known, x_idx, inv_idx);
+        }
+        for(unsigned i=0; i != gates.size(); i++) {
+            _apply_ternary(gates[i], val, known);
+            if((int) gates[i].out == x_idx || (int) gates[i].out == inv_idx) {
+                _override_ternary(gates[i].out, val, known, x_idx, inv_idx);
+            }
+        }
+    }
+
+    void bitsim_t::eval(frame_t& f, rng_t& rng) const
+    {
+        const unsigned words = f.words;
+        assert(f.values.size() == ckt.num_nodes() * words);
+
+        word_t* tmp = &f.scratch[0];
+        word_t* rem = &f.scratch[words];
+
+        for(unsigned i=0; i != gates.size(); i++) {
+            const gate_t& g = gates[i];
+            word_t* out = &f.values[g.out * words];
+
+            _apply(g.function, g, f, out);
+
+            if(g.poly_begin != g.poly_end) {
+                for(unsigned w=0; w != words; w++) rem[w] = ~(word_t)0;
+                for(unsigned p=g.poly_begin; p != g.poly_end; p++) {
+                    _apply(polys[p].function, g, f, tmp);
+                    for(unsigned w=0; w != words; w++) {
+                        word_t sel = rng.bernoulli(polys[p].select) & rem[w];
+                        out[w] = (out[w] & ~sel) | (tmp[w] & sel);
+                        rem[w] &= ~sel;
+                    }
+                }
+            }
+
+            if(g.flip != 0) {
+                for(unsigned w=0; w != words; w++) {
+                    out[w] ^= rng.bernoulli(g.flip);
+                }
+            }
+        }
+    }
+
+    void bitsim_t::init_fault_frame(fault_frame_t& ff, const frame_t& good) const
+    {
+        ff.frame = good;
+        ff.queue.clear();
+        ff.queued.assign(gates.size(), false);
+        ff.changed.clear();
+    }
+
+    void bitsim_t::_schedule_fanouts(fault_frame_t& ff, unsigned idx) const
+    {
+        const flatckt_t& flat = ckt.flat;
+        const unsigned* fo = flat.fanouts_of(idx);
+        for(unsigned j=0, m=flat.num_fanouts(idx); j != m; j++) {
+            int p = gate_pos[fo[j]];
+            assert(p >= 0);
+            if(!ff.queued[p]) {
+                ff.queued[p] = true;
+                ff.queue.push_back(p);
+                std::push_heap(ff.queue.begin(), ff.queue.end(), std::greater<unsigned>());
+            }
+        }
+    }
+
+    uint64_t bitsim_t::eval_flip(const frame_t& good, fault_frame_t& ff, unsigned idx, unsigned nlanes) const
+    {
+        frame_t& f = ff.frame;
+        const unsigned words = f.words;
+        assert(good.words == words && f.values.size() == good.values.size());
+        assert(nlanes <= f.lanes());
+        assert(ff.queue.empty() && ff.changed.empty());
+
+        word_t* v = &f.values[idx * words];
+        for(unsigned w=0; w != words; w++) v[w] = ~v[w];
+        ff.changed.push_back(idx);
+        _schedule_fanouts(ff, idx);
+
+        // the gates are in level order, so a gate is evaluated after all
+        // of its changed fan-ins, and only once.
+        word_t* tmp = &f.scratch[0];
+        while(!ff.queue.empty()) {
+            std::pop_heap(ff.queue.begin(), ff.queue.end(), std::greater<unsigned>());
+            unsigned p = ff.queue.back();
+            ff.queue.pop_back();
+            ff.queued[p] = false;
+
+            const gate_t& g = gates[p];
+            _apply(g.function, g, f, tmp);
+            word_t* out = &f.values[g.out * words];
+            word_t diff = 0;
+            for(unsigned w=0; w != words; w++) diff |= tmp[w] ^ out[w];
+            if(diff) {
+                std::copy(tmp, tmp + words, out);
+                ff.changed.push_back(g.out);
+                _schedule_fanouts(ff, g.out);
+            }
+        }
+
+        // lanes past nlanes are masked off.
+        const unsigned full = nlanes / WORD_BITS;
+        const word_t last = (nlanes % WORD_BITS) ? (((word_t)1 << (nlanes % WORD_BITS)) - 1) : 0;
+        uint64_t cnt = 0;
+        for(unsigned i=0; i != outputs.size(); i++) {
+            const word_t* a = &good.values[outputs[i] * words];
+            const word_t* b = &f.values[outputs[i] * words];
+            for(unsigned w=0; w != full; w++) {
+                cnt += __builtin_popcountll(a[w] ^ b[w]);
+            }
+            if(last) {
+                cnt += __builtin_popcountll((a[full] ^ b[full]) & last);
+            }
+        }
+
+        for(unsigned i=0; i != ff.changed.size(); i++) {
+            unsigned c = ff.changed[i];
+            std::copy(&good.values[c * words], &good.values[c * words] + words, &f.values[c * words]);
+        }
+        ff.changed.clear();
+        return cnt;
+    }
+}
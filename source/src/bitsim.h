@@ -0,0 +1,164 @@
+#ifndef _BITSIM_H_DEFINED_
+#define _BITSIM_H_DEFINED_
+
+#include <vector>
+#include <stdint.h>
+#include "ckt.h"
+
+namespace ckt_n {
+
+    // xorshift128+ generator. each simulation stream owns one of these, so
+    // no global state (i.e., rand()) is touched while simulating.
+    struct rng_t {
+        uint64_t s[2];
+
+        rng_t(uint64_t seed = 0) { seed_with(seed); }
+
+        // expand the seed using splitmix64; the state must never be all-zero.
+        void seed_with(uint64_t seed);
+
+        uint64_t next() {
+            uint64_t x = s[0];
+            const uint64_t y = s[1];
+            s[0] = y;
+            x ^= x << 23;
+            s[1] = x ^ y ^ (x >> 17) ^ (y >> 26);
+            return s[1] + y;
+        }
+
+        // returns a word whose bits are independently set with probability
+        // thresh / 2^PROB_BITS. costs one call to next() per significant bit
+        // of thresh instead of one per bit of the result.
+        uint64_t bernoulli(uint32_t thresh);
+
+        static const unsigned PROB_BITS = 16;
+        static const uint32_t PROB_ONE = (1u << PROB_BITS);
+        // convert a percentage (as used in the .stoch files) to a threshold.
+        static uint32_t threshold(double percent);
+    };
+
+    // seed derived from the high-resolution clock, same as the one used for
+    // srand() elsewhere.
+    uint64_t time_seed();
+
+    // Word-parallel (bit-parallel) simulator.
+    //
+    // The circuit is compiled once into a flat array of gates in level
+    // order, with the fan-ins taken from the flat copy of the circuit
+    // (ckt_t::flat). Every node is then simulated for 64*words patterns
+    // (lanes) per pass, each lane being one independent pattern/sample.
+    // Stochastic gates flip their output in each lane independently, and
+    // polymorphic gates select their function per lane, so the lanes are
+    // equivalent to repeated calls of eval_t::eval.
+    //
+    // The compiled circuit is read-only; all values live in a frame_t, so
+    // several frames can be simulated concurrently. If the circuit is
+    // modified, the simulator has to be rebuilt.
+    struct bitsim_t {
+        typedef uint64_t word_t;
+        static const unsigned WORD_BITS = 64;
+        // 4 words, i.e., 256 lanes per pass; the per-word loops are simple
+        // enough to be vectorized (e.g., to AVX2) with -march=native.
+        static const unsigned DEFAULT_WORDS = 4;
+
+        struct poly_t {
+            fct         function;
+            // probability of selecting this function among the lanes that
+            // haven't selected any of the preceding functions.
+            uint32_t    select;
+        };
+
+        struct gate_t {
+            fct         function;
+            unsigned    out;
+            unsigned    fanin_begin, fanin_end;
+            unsigned    poly_begin, poly_end;
+            uint32_t    flip;
+        };
+
+        struct frame_t {
+            unsigned            words;
+            std::vector<word_t> values;
+            std::vector<word_t> scratch;
+
+            unsigned lanes() const { return words * WORD_BITS; }
+        };
+
+        // state for fault simulation: a copy of the fault-free frame, in
+        // which the fanout cone of the faulty node is re-simulated, and the
+        // gates still to be evaluated. one per thread.
+        struct fault_frame_t {
+            frame_t                 frame;
+            std::vector<unsigned>   queue;
+            std::vector<bool>       queued;
+            std::vector<unsigned>   changed;
+        };
+
+        ckt_t&                  ckt;
+        std::vector<gate_t>     gates;
+        std::vector<unsigned>   fanins;
+        std::vector<poly_t>     polys;
+        std::vector<unsigned>   outputs;
+        // position of the gate driving each node in gates; -1 for inputs.
+        std::vector<int>        gate_pos;
+        bool                    stochastic;
+
+        bitsim_t(ckt_t& c);
+
+        void init_frame(frame_t& f, unsigned words) const;
+
+        // set the value of node idx in one lane, or in all lanes.
+        void set_value(frame_t& f, unsigned idx, unsigned lane, bool v) const {
+            word_t mask = (word_t)1 << (lane % WORD_BITS);
+            word_t& w = f.values[idx * f.words + lane / WORD_BITS];
+            w = v ? (w | mask) : (w & ~mask);
+        }
+        void set_value(frame_t& f, unsigned idx, bool v) const;
+
+        bool get_value(const frame_t& f, unsigned idx, unsigned lane) const {
+            word_t w = f.values[idx * f.words + lane / WORD_BITS];
+            return (w >> (lane % WORD_BITS)) & 1;
+        }
+        const word_t* get_words(const frame_t& f, unsigned idx) const {
+            return &f.values[idx * f.words];
+        }
+
+        bool get_output(const frame_t& f, unsigned o, unsigned lane) const {
+            return get_value(f, outputs[o], lane);
+        }
+        void get_outputs(const frame_t& f, unsigned lane, std::vector<bool>& outs) const;
+        // same, but packed into (num_outputs + 63) / 64 words.
+        void get_outputs(const frame_t& f, unsigned lane, word_t* outs) const;
+
+        // simulate all gates of the circuit for all lanes of the frame.
+        void eval(frame_t& f, rng_t& rng) const;
+
+        // three-valued simulation, in dual-rail form: a node is known in a
+        // lane iff its bit in known is set, and then its value is the bit
+        // in val (unknown nodes always have their val bit cleared). the
+        // inputs have to be set in both frames; stochastic behaviour is
+        // ignored.
+        void eval_ternary(frame_t& val, frame_t& known) const;
+        // same, but node x_idx is forced to be unknown and node inv_idx is
+        // inverted (where it is known); either can be -1. if these are
+        // inputs, their values in the frames are overwritten.
+        void eval_ternary(frame_t& val, frame_t& known, int x_idx, int inv_idx) const;
+
+        // single fault propagation: the value of node idx is flipped in all
+        // lanes of good, and only the gates whose inputs changed are
+        // re-evaluated (event driven, in level order). returns the number of
+        // (lane, output) pairs in the first nlanes lanes which differ from
+        // good; ff is restored to good afterwards. good must have been
+        // simulated already; stochastic behaviour is ignored.
+        void init_fault_frame(fault_frame_t& ff, const frame_t& good) const;
+        uint64_t eval_flip(const frame_t& good, fault_frame_t& ff, unsigned idx, unsigned nlanes) const;
+
+    private:
+        void _schedule_fanouts(fault_frame_t& ff, unsigned idx) const;
+        void _apply(fct function, const gate_t& g, const frame_t& f, word_t* out) const;
+        void _apply_ternary(const gate_t& g, frame_t& val, frame_t& known) const;
+        void _override_ternary(unsigned idx, frame_t& val, frame_t& known, int x_idx, int inv_idx) const;
+    };
+}
+
+#endif
@@ -8,6 +8,9 @@
 #include "kcut.h"
 // JOHANN
 #include <fstream>
+#include <sstream>
+#include <queue>
+#include <functional>
 
 namespace ckt_n {
     ckt_t::ckt_t(const ckt_t& ckt, node_t* n_cut,
@@ -384,12 +387,13 @@ namespace ckt_n {
         }
     }
 
-    ckt_t::ckt_t(ast_n::statements_t& stms)
+    ckt_t::ckt_t(const bench_file_t& bench)
     {
-        map_t map;
-        _init_map(map, stms);
-        _init_inputs(map, stms);
-        _init_outputs(map, stms);
+        span_map_t map;
+        map.reserve(bench.decls.size());
+        _init_map(map, bench);
+        _init_inputs(map, bench);
+        _init_outputs(map, bench);
         _init_fanouts();
         _init_indices();
         topo_sort();
@@ -398,16 +402,117 @@ namespace ckt_n {
         assert(outputs.size() <= nodes.size());
     }
 
+    ckt_t::ckt_t(const ckt_cache_t& cache)
+    {
+        // the image has the same node order as the bench file, as well as
+        // the levels and the sorted lists, so there's nothing to look up
+        // and nothing to sort.
+        const ckt_cache_t::header_t& h = *cache.header;
+        unsigned n = h.num_nodes;
+
+        nodes.resize(n);
+        for(unsigned i=0; i != n; i++) {
+            std::string name(cache.names + cache.name_begin[i]);
+            node_t* nd;
+            if(cache.flags[i] & flatckt_t::INPUT) {
+                nd = node_t::create_input(name);
+                inputs.push_back(nd);
+            } else {
+                nd = node_t::create_gate(name, std::string(cache.funcs + cache.func_begin[i]));
+                gates.push_back(nd);
+            }
+            nd->index = i;
+            nd->level = cache.levels[i];
+            nd->output = (cache.flags[i] & flatckt_t::OUTPUT) != 0;
+            nd->error_rate = cache.error_rates[i];
+            for(unsigned j=cache.poly_begin[i]; j != cache.poly_begin[i+1]; j++) {
+                poly_fct p;
+                p.function = (fct) cache.polys[j].function;
+                p.name = cache.poly_names + cache.polys[j].name_begin;
+                p.probability = cache.polys[j].probability;
+                nd->polymorphic_fcts.push_back(p);
+            }
+            nodes[i] = nd;
+        }
+
+        for(unsigned i=0; i != n; i++) {
+            node_t* nd = nodes[i];
+            nd->inputs.resize(cache.fanin_begin[i+1] - cache.fanin_begin[i]);
+            for(unsigned j=0; j != nd->inputs.size(); j++) {
+                nd->inputs[j] = nodes[cache.fanins[cache.fanin_begin[i] + j]];
+            }
+            nd->fanouts.resize(cache.fanout_begin[i+1] - cache.fanout_begin[i]);
+            for(unsigned j=0; j != nd->fanouts.size(); j++) {
+                nd->fanouts[j] = nodes[cache.fanouts[cache.fanout_begin[i] + j]];
+            }
+        }
+
+        ckt_inputs.resize(h.num_ckt_inputs);
+        for(unsigned i=0; i != ckt_inputs.size(); i++) {
+            ckt_inputs[i] = nodes[cache.ckt_inputs[i]];
+        }
+        key_inputs.resize(h.num_key_inputs);
+        for(unsigned i=0; i != key_inputs.size(); i++) {
+            key_inputs[i] = nodes[cache.key_inputs[i]];
+        }
+        outputs.resize(h.num_outputs);
+        for(unsigned i=0; i != outputs.size(); i++) {
+            outputs[i] = nodes[cache.outputs[i]];
+        }
+        nodes_sorted.resize(n);
+        for(unsigned i=0; i != n; i++) {
+            nodes_sorted[i] = nodes[cache.order[i]];
+        }
+        gates_sorted.resize(h.num_gates);
+        for(unsigned i=0; i != gates_sorted.size(); i++) {
+            gates_sorted[i] = nodes[cache.gate_order[i]];
+        }
+
+        // the flat copy is the image itself.
+        flat.functions.resize(n);
+        for(unsigned i=0; i != n; i++) {
+            flat.functions[i] = (fct) cache.functions[i];
+        }
+        flat.flags.assign(cache.flags, cache.flags + n);
+        flat.levels.assign(cache.levels, cache.levels + n);
+        flat.fanin_begin.assign(cache.fanin_begin, cache.fanin_begin + n + 1);
+        flat.fanins.assign(cache.fanins, cache.fanins + h.num_fanins);
+        flat.fanout_begin.assign(cache.fanout_begin, cache.fanout_begin + n + 1);
+        flat.fanouts.assign(cache.fanouts, cache.fanouts + h.num_fanouts);
+        flat.name_begin.assign(cache.name_begin, cache.name_begin + n + 1);
+        flat.names.assign(cache.names, cache.names + h.num_name_chars);
+        flat.order.assign(cache.order, cache.order + n);
+        flat.gate_order.assign(cache.gate_order, cache.gate_order + h.num_gates);
+        flat.ckt_inputs.assign(cache.ckt_inputs, cache.ckt_inputs + h.num_ckt_inputs);
+        flat.key_inputs.assign(cache.key_inputs, cache.key_inputs + h.num_key_inputs);
+        flat.outputs.assign(cache.outputs, cache.outputs + h.num_outputs);
+
+        stochastic_gates = h.stochastic_gates;
+        IO_sampling_flag = h.IO_sampling_flag != 0;
+        IO_sampling_iter = h.IO_sampling_iter;
+        IO_sampling_for_test_flag = h.IO_sampling_for_test_flag != 0;
+        test_patterns = h.test_patterns;
+        IO_sampling_adaptive_flag = h.IO_sampling_adaptive_flag != 0;
+        IO_sampling_adaptive_error = h.IO_sampling_adaptive_error;
+
+        assert(inputs.size() + gates.size() == nodes.size());
+        assert(outputs.size() <= nodes.size());
+    }
+
     ckt_t::ckt_t(nodepair_list_t& pair_map)
     {
         for(unsigned i=0; i != pair_map.size(); i++) {
             node_t* nA = pair_map[i].first;
             node_t* nB = pair_map[i].second;
             if(nA == nB) {
-                assert(node_t::INPUT == nA->type);
-                inputs.push_back(nA);
+                // shared by both copies.
+                if(node_t::INPUT == nA->type) {
+                    inputs.push_back(nA);
+                    ckt_inputs.push_back(nA);
+                } else {
+                    gates.push_back(nA);
+                }
                 nodes.push_back(nA);
-                ckt_inputs.push_back(nA);
             } else {
                 assert(nA->type == nB->type);
                 if(node_t::INPUT == nA->type) {
@@ -472,6 +577,7 @@ namespace ckt_n {
 
     void ckt_t::init_node_map(map_t& map)
     {
+        map.reserve(map.size() + nodes.size());
         for(unsigned i=0; i != nodes.size(); i++) {
             node_t* ni = nodes[i];
             assert(map.find(ni->name) == map.end());
@@ -479,15 +585,15 @@ namespace ckt_n {
         }
     }
 
-    void ckt_t::_init_map(map_t& map, ast_n::statements_t& stms)
+    void ckt_t::_init_map(span_map_t& map, const bench_file_t& bench)
     {
-        using namespace ast_n;
+        typedef bench_file_t::decl_t decl_t;
 
-        for(unsigned i=0; i != stms.size(); i++) {
-            statement_t& stm = stms[i];
-            if(stm.type == statement_t::INPUT) {
-                node_t* inp = node_t::create_input(stm.input->name);
-                map[inp->name] = inp;
+        for(unsigned i=0; i != bench.decls.size(); i++) {
+            const decl_t& d = bench.decls[i];
+            if(d.type == decl_t::INPUT) {
+                node_t* inp = node_t::create_input(d.name.str());
+                map[d.name] = inp;
                 inputs.push_back(inp);
                 if(inp->is_keyinput()) {
                     key_inputs.push_back(inp);
@@ -495,38 +601,36 @@ namespace ckt_n {
                     ckt_inputs.push_back(inp);
                 }
                 nodes.push_back(inp);
-            } else if(stm.type == statement_t::GATE) {
-                node_t* g = node_t::create_gate(
-                    stm.gate->output, 
-                    stm.gate->function
-                );
-                map[g->name] = g;
+            } else if(d.type == decl_t::GATE) {
+                node_t* g = node_t::create_gate(d.name.str(), d.function.str());
+                map[d.name] = g;
                 gates.push_back(g);
                 nodes.push_back(g);
             }
         }
     }
 
-    void ckt_t::_init_inputs(map_t& map, ast_n::statements_t& stms)
+    void ckt_t::_init_inputs(span_map_t& map, const bench_file_t& bench)
     {
-        using namespace ast_n;
+        typedef bench_file_t::decl_t decl_t;
 
-        for(unsigned i=0; i != stms.size(); i++) {
-            statement_t& stm = stms[i];
-            if(stm.type == statement_t::GATE) {
-                gate_decl_t* g = stms[i].gate;
-                map_t::iterator pos = map.find(g->output);
+        for(unsigned i=0; i != bench.decls.size(); i++) {
+            const decl_t& d = bench.decls[i];
+            if(d.type == decl_t::GATE) {
+                span_map_t::iterator pos = map.find(d.name);
                 assert(map.end() != pos);
                 node_t* node = pos->second;
 
-                for(unsigned i=0; i != g->inputs.size(); i++) {
-                    std::string& name = g->inputs[i];
-                    map_t::iterator pos = map.find(name);
+                node->inputs.reserve(d.inputs_end - d.inputs_begin);
+                for(unsigned j=d.inputs_begin; j != d.inputs_end; j++) {
+                    span_map_t::iterator pos = map.find(bench.gate_inputs[j]);
                     if(map.end() == pos) {
-                        std::cerr << "Unknown input \'" << name 
+                        std::cerr << bench.filename << ":" << d.line << ": "
+                                  << "Unknown input \'" << bench.gate_inputs[j].str()
                                   << "\' in the following declaration: "
-                                  << std::endl 
-                                  << stm << std::endl; 
+                                  << std::endl;
+                        bench.print_decl(std::cerr, d);
+                        std::cerr << std::endl;
                         exit(1);
                     }
                     node_t* inp = pos->second;
@@ -536,17 +640,16 @@ namespace ckt_n {
         }
     }
 
-    void ckt_t::_init_outputs(map_t& map, ast_n::statements_t& stms)
+    void ckt_t::_init_outputs(span_map_t& map, const bench_file_t& bench)
     {
-        using namespace ast_n;
+        typedef bench_file_t::decl_t decl_t;
 
-        for(unsigned i=0; i != stms.size(); i++) {
-            statement_t& stm = stms[i];
-            if(stm.type == statement_t::OUTPUT) {
-                output_decl_t* o = stms[i].output;
-                map_t::iterator pos = map.find(o->name);
+        for(unsigned i=0; i != bench.decls.size(); i++) {
+            const decl_t& d = bench.decls[i];
+            if(d.type == decl_t::OUTPUT) {
+                span_map_t::iterator pos = map.find(d.name);
                 if(map.end() == pos) {
-                    std::cerr << "Unknown output: " << o->name << std::endl;
+                    std::cerr << "Unknown output: " << d.name.str() << std::endl;
                     exit(1);
                 }
                 pos->second->output = true;
@@ -582,33 +685,32 @@ namespace ckt_n {
         node_t* diff,
         const nodeset_t& internals,
         const nodeset_t& inputs,
-        node2var_map_t& n2v1,
-        node2var_map_t& n2v2
+        index2var_map_t& n2v1,
+        index2var_map_t& n2v2
     )
     {
         using namespace sat_n;
+        n2v1.assign(num_nodes(), -1);
+        n2v2.assign(num_nodes(), -1);
         for(auto it=internals.begin(); it != internals.end(); it++) {
             node_t* ni = *it;
             assert(inputs.find(ni) == inputs.end());
-            n2v1[ni] = S.newVar();
-            n2v2[ni] = S.newVar();
+            n2v1[ni->get_index()] = S.newVar();
+            n2v2[ni->get_index()] = S.newVar();
         }
         for(auto it = inputs.begin(); it != inputs.end(); it++) {
             node_t* ni = *it;
             assert(internals.find(ni) == internals.end());
             if(ni != diff) {
-                n2v1[ni] = n2v2[ni] = S.newVar();
+                n2v1[ni->get_index()] = n2v2[ni->get_index()] = S.newVar();
             } else {
-                n2v1[ni] = S.newVar();
-                n2v2[ni] = S.newVar();
+                n2v1[ni->get_index()] = S.newVar();
+                n2v2[ni->get_index()] = S.newVar();
             }
         }
 
-        assert(n2v1.find(out) != n2v1.end());
-        assert(n2v2.find(out) != n2v2.end());
-
-        Lit o1 = mkLit(n2v1[out]);
-        Lit o2 = mkLit(n2v2[out]);
+        Lit o1 = mkLit(node_var(n2v1, out));
+        Lit o2 = mkLit(node_var(n2v2, out));
 
         Lit y = mkLit(S.newVar());
 
@@ -625,9 +727,9 @@ namespace ckt_n {
     {
         using namespace sat_n;
 
-        node2var_map_t node2vars;
+        index2var_map_t node2vars(nodes.size(), -1);
         for(unsigned i=0; i != nodes.size(); i++) {
-            node2vars[nodes[i]] = Var(i+1);
+            node2vars[nodes[i]->get_index()] = Var(i+1);
         }
         while(S.nVars() <= (int) (nodes.size()+1)) {
             S.newVar();
@@ -647,7 +749,7 @@ namespace ckt_n {
             node_t* n = nodes[i];
             int idx = n->get_index();
             assert(idx >= 0 && idx < (int) nodes.size());
-            mappings[idx] = mkLit(node2vars[n]);
+            mappings[idx] = mkLit(node2vars[idx]);
         }
     }
 
@@ -656,9 +758,9 @@ namespace ckt_n {
     {
         using namespace sat_n;
 
-        node2var_map_t node2vars;
+        index2var_map_t node2vars(nodes.size(), -1);
         for(unsigned i=0; i != nodes.size(); i++) {
-            node2vars[nodes[i]] = Var(i+1);
+            node2vars[nodes[i]->get_index()] = Var(i+1);
         }
         while(S.nVars() <= (int) (nodes.size()+1)) {
             S.newVar();
@@ -676,7 +778,7 @@ namespace ckt_n {
             node_t* n = nodes[i];
             int idx = n->get_index();
             assert(idx >= 0 && idx < (int) nodes.size());
-            mappings[idx] = mkLit(node2vars[n]);
+            mappings[idx] = mkLit(node2vars[idx]);
         }
     }
 
@@ -691,9 +793,9 @@ namespace ckt_n {
         using namespace sat_n;
 
         int nVars = nodes.size()+1;
-        node2var_map_t node2vars;
+        index2var_map_t node2vars(nodes.size(), -1);
         for(unsigned i=0; i != nodes.size(); i++) {
-            node2vars[nodes[i]] = Var(i+1);
+            node2vars[nodes[i]->get_index()] = Var(i+1);
         }
 
         std::vector<Var> eqVars, uqVars, eq2Vars;
@@ -703,7 +805,7 @@ namespace ckt_n {
         {
             node_t* n = *it;
             assert(n->is_input());
-            eqVars.push_back(node2vars[n]);
+            eqVars.push_back(node_var(node2vars, n));
         }
         for(nodeset_t::const_iterator it = uq.begin();
                                       it != uq.end();
@@ -711,7 +813,7 @@ namespace ckt_n {
         {
             node_t* n = *it;
             assert(n->is_input());
-            uqVars.push_back(node2vars[n]);
+            uqVars.push_back(node_var(node2vars, n));
         }
 
         for(unsigned i=0; i != nodes.size(); i++) {
@@ -719,13 +821,13 @@ namespace ckt_n {
             if(eq.find(n) == eq.end() &&
                uq.find(n) == uq.end())
             {
-                eq2Vars.push_back(node2vars[n]);
+                eq2Vars.push_back(node_var(node2vars, n));
             }
         }
         assert(eqVars.size() == eq.size());
         assert(uqVars.size() == uq.size());
         assert((eqVars.size() + uqVars.size() + eq2Vars.size()) == nodes.size());
-        S.initialize(nVars, eqVars, uqVars, eq2Vars, mkLit(node2vars[output]));
+        S.initialize(nVars, eqVars, uqVars, eq2Vars, mkLit(node_var(node2vars, output)));
 
         for(unsigned i=0; i != gates.size(); i++) {
             node_t* n = gates[i];
@@ -739,7 +841,7 @@ namespace ckt_n {
             node_t* n = nodes[i];
             int idx = n->get_index();
             assert(idx >= 0 && idx < (int) nodes.size());
-            mappings[idx] = mkLit(node2vars[n]);
+            mappings[idx] = mkLit(node2vars[idx]);
         }
     }
 
@@ -755,9 +857,9 @@ namespace ckt_n {
     {
         using namespace sat_n;
 
-        node2var_map_t node2vars;
+        index2var_map_t node2vars(nodes.size(), -1);
         for(unsigned i=0; i != nodes.size(); i++) {
-            node2vars[nodes[i]] = Var(2*i+1);
+            node2vars[nodes[i]->get_index()] = Var(2*i+1);
         }
         while(S.nVars() <= (int) (2*nodes.size()+1)) {
             S.newVar();
@@ -775,7 +877,7 @@ namespace ckt_n {
             node_t* n = nodes[i];
             int idx = n->get_index();
             assert(idx >= 0 && idx < (int) nodes.size());
-            mappings[idx] = mkLit(node2vars[n]);
+            mappings[idx] = mkLit(node2vars[idx]);
         }
     }
 
@@ -798,9 +900,9 @@ namespace ckt_n {
     {
         using namespace sat_n;
 
-        node2var_map_t node2vars;
+        index2var_map_t node2vars(nodes.size(), -1);
         for(unsigned i=0; i != nodes.size(); i++) {
-            node2vars[nodes[i]] = Var(i+1);
+            node2vars[nodes[i]->get_index()] = Var(i+1);
         }
         while(S.nVars() <= (int) (nodes.size()+1)) {
             S.newVar();
@@ -818,7 +920,7 @@ namespace ckt_n {
             node_t* n = nodes[i];
             int idx = n->get_index();
             assert(idx >= 0 && idx < (int) nodes.size());
-            mappings[idx] = mkLit(node2vars[n]);
+            mappings[idx] = mkLit(node2vars[idx]);
         }
     }
 
@@ -826,9 +928,9 @@ namespace ckt_n {
     {
         using namespace sat_n;
 
-        node2var_map_t node2vars;
+        index2var_map_t node2vars(nodes.size(), -1);
         for(unsigned i=0; i != nodes.size(); i++) {
-            node2vars[nodes[i]] = Var(i+1);
+            node2vars[nodes[i]->get_index()] = Var(i+1);
         }
         while(S.nVars() <= (int) (nodes.size()+1)) {
             S.newVar();
@@ -846,7 +948,7 @@ namespace ckt_n {
             node_t* n = nodes[i];
             int idx = n->get_index();
             assert(idx >= 0 && idx < (int) nodes.size());
-            mappings[idx] = mkLit(node2vars[n]);
+            mappings[idx] = mkLit(node2vars[idx]);
         }
     }
 
@@ -855,9 +957,9 @@ namespace ckt_n {
     {
         using namespace sat_n;
 
-        node2var_map_t node2vars;
+        index2var_map_t node2vars(nodes.size(), -1);
         for(unsigned i=0; i != nodes.size(); i++) {
-            node2vars[nodes[i]] = Var(i+1);
+            node2vars[nodes[i]->get_index()] = Var(i+1);
         }
         while(S1.nVars() <= (int) (nodes.size()+1)) { S1.newVar(); }
         while(S2.nVars() <= (int) (nodes.size()+1)) { S2.newVar(); }
@@ -881,7 +983,7 @@ namespace ckt_n {
             node_t* n = nodes[i];
             int idx = n->get_index();
             assert(idx >= 0 && idx < (int) nodes.size());
-            mappings[idx] = mkLit(node2vars[n]);
+            mappings[idx] = mkLit(node2vars[idx]);
         }
     }
 
@@ -892,9 +994,9 @@ namespace ckt_n {
     {
         using namespace sat_n;
 
-        node2var_map_t node2vars;
+        index2var_map_t node2vars(nodes.size(), -1);
         for(unsigned i=0; i != nodes.size(); i++) {
-            node2vars[nodes[i]] = Var(i+1);
+            node2vars[nodes[i]->get_index()] = Var(i+1);
         }
         while(S1.nVars() <= (int) (nodes.size()+1)) { S1.newVar(); }
         while(S2.nVars() <= (int) (nodes.size()+1)) { S2.newVar(); }
@@ -920,7 +1022,7 @@ namespace ckt_n {
             node_t* n = nodes[i];
             int idx = n->get_index();
             assert(idx >= 0 && idx < (int) nodes.size());
-            mappings[idx] = mkLit(node2vars[n]);
+            mappings[idx] = mkLit(node2vars[idx]);
         }
     }
 
@@ -945,54 +1047,136 @@ namespace ckt_n {
 
     void ckt_t::topo_sort()
     {
+        // levelize by a depth-first traversal of the fan-ins, visiting each
+        // node and edge once. only the inputs lists are used, as some
+        // encoders fix up the fanouts lists later. level -1 marks nodes not
+        // visited yet and -2 nodes on the stack.
         for(unsigned i=0; i != num_inputs(); i++) {
             inputs[i]->level = 0;
         }
+        for(unsigned i=0; i != num_gates(); i++) {
+            gates[i]->level = -1;
+        }
 
-        bool changed = false;
-        do { 
-            changed = false;
-            for(unsigned i=0; i != num_gates(); i++) {
-                node_t* g = gates[i];
-                for(unsigned j=0; j != g->num_inputs(); j++) {
-                    node_t* gi = g->inputs[j];
-                    if(g->level < (1 + gi->level)) {
-                        g->level = 1+gi->level;
-                        changed = true;
+        int max_level = 0;
+        std::vector< std::pair<node_t*, unsigned> > stack;
+        for(unsigned i=0; i != num_gates(); i++) {
+            if(gates[i]->level != -1) continue;
+
+            gates[i]->level = -2;
+            stack.push_back(std::make_pair(gates[i], 0u));
+            while(!stack.empty()) {
+                node_t* n = stack.back().first;
+                unsigned j = stack.back().second;
+                if(j < n->num_inputs()) {
+                    stack.back().second += 1;
+                    node_t* ni = n->inputs[j];
+                    if(ni->level == -1) {
+                        ni->level = -2;
+                        stack.push_back(std::make_pair(ni, 0u));
+                    } else if(ni->level == -2) {
+                        std::cerr << "Error: combinational cycle through " << ni->name << "." << std::endl;
+                        exit(1);
                     }
+                } else {
+                    n->level = _compute_level(n);
+                    if(n->level > max_level) max_level = n->level;
+                    stack.pop_back();
                 }
             }
-        } while(changed);
+        }
 
-        nodes_sorted.resize(nodes.size());
-        gates_sorted.resize(gates.size());
-        std::copy(gates.begin(), gates.end(), gates_sorted.begin());
-        std::copy(nodes.begin(), nodes.end(), nodes_sorted.begin());
+        _sort_by_level(nodes, nodes_sorted, max_level);
+        _sort_by_level(gates, gates_sorted, max_level);
 
-        std::sort(gates_sorted.begin(), gates_sorted.end(), node_topo_cmp);
-        std::sort(nodes_sorted.begin(), nodes_sorted.end(), node_topo_cmp);
+        // the flat copy needs valid indices; some callers only fix them up
+        // after sorting.
+        bool indices_ok = true;
+        for(unsigned i=0; i != nodes.size() && indices_ok; i++) {
+            indices_ok = (nodes[i]->index == (int) i);
+        }
+        if(indices_ok) {
+            flat.build(*this);
+        } else {
+            flat.clear();
+        }
+    }
+
+    int ckt_t::_compute_level(const node_t* n)
+    {
+        if(n->is_input()) return 0;
+
+        int level = 0;
+        for(unsigned j=0; j != n->num_inputs(); j++) {
+            // mux key gates are created with a placeholder input.
+            if(n->inputs[j] != NULL && level < 1 + n->inputs[j]->level) {
+                level = 1 + n->inputs[j]->level;
+            }
+        }
+        return level;
+    }
+
+    void ckt_t::_sort_by_level(const nodelist_t& in, nodelist_t& out, int max_level)
+    {
+        // counting sort; nodes on the same level keep their relative order.
+        std::vector<unsigned> pos(max_level+2, 0);
+        for(unsigned i=0; i != in.size(); i++) {
+            pos[in[i]->level+1] += 1;
+        }
+        for(int l=0; l <= max_level; l++) {
+            pos[l+1] += pos[l];
+        }
+        out.resize(in.size());
+        for(unsigned i=0; i != in.size(); i++) {
+            out[pos[in[i]->level]++] = in[i];
+        }
+    }
+
+    void ckt_t::update_levels(node_t* n)
+    {
+        // nodes are processed in the order of their level at the time they
+        // are queued, so the fan-ins of a node in the cone are done before
+        // the node itself.
+        typedef std::pair<int, node_t*> entry_t;
+        std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t> > queue;
+
+        n->level = _compute_level(n);
+        for(unsigned i=0; i != n->num_fanouts(); i++) {
+            queue.push(entry_t(n->fanouts[i]->level, n->fanouts[i]));
+        }
+        while(!queue.empty()) {
+            node_t* g = queue.top().second;
+            queue.pop();
+
+            int level = _compute_level(g);
+            if(level != g->level) {
+                g->level = level;
+                for(unsigned i=0; i != g->num_fanouts(); i++) {
+                    queue.push(entry_t(g->fanouts[i]->level, g->fanouts[i]));
+                }
+            }
+        }
     }
 
     void ckt_t::init_keymap(std::vector< std::vector<bool> >& keymap)
     {
+        assert(flat.num_nodes() == num_nodes());
+
         keymap.resize(num_nodes());
-        for(unsigned i=0; i != nodes_sorted.size(); i++) {
-            keymap[i].resize(num_key_inputs(), false);
-            std::fill(keymap[i].begin(), keymap[i].end(), false);
+        for(unsigned i=0; i != keymap.size(); i++) {
+            keymap[i].assign(num_key_inputs(), false);
         }
 
-        for(unsigned i=0; i != num_key_inputs(); i++) {
-            node_t* ki = key_inputs[i];
-            keymap[ki->get_index()][i] = true;
+        for(unsigned i=0; i != flat.key_inputs.size(); i++) {
+            keymap[flat.key_inputs[i]][i] = true;
         }
 
-        for(unsigned i=0; i != nodes_sorted.size(); i++) {
-            node_t* n = nodes_sorted[i];
-            int index = n->get_index();
-
-            if(n->is_gate()) {
-                for(unsigned j=0; j != n->num_inputs(); j++) {
-                    or_bitmap(keymap[index], keymap[n->inputs[j]->get_index()]);
+        for(unsigned i=0; i != flat.order.size(); i++) {
+            unsigned index = flat.order[i];
+            if(flat.is_gate(index)) {
+                const unsigned* fi = flat.fanins_of(index);
+                for(unsigned j=0, m=flat.num_fanins(index); j != m; j++) {
+                    or_bitmap(keymap[index], keymap[fi[j]]);
                 }
             }
         }
@@ -1000,21 +1184,21 @@ namespace ckt_n {
 
     void ckt_t::init_outputmap(std::vector< std::vector<bool> >& outmap)
     {
+        assert(flat.num_nodes() == num_nodes());
+
         outmap.resize(num_nodes());
-        for(unsigned i=0; i != nodes_sorted.size(); i++) {
-            outmap[i].resize(num_outputs(), false);
-            std::fill(outmap[i].begin(), outmap[i].end(), false);
+        for(unsigned i=0; i != outmap.size(); i++) {
+            outmap[i].assign(num_outputs(), false);
         }
-        for(unsigned i=0; i != num_outputs(); i++) {
-            node_t* oi = outputs[i];
-            outmap[oi->get_index()][i] = true;
+        for(unsigned i=0; i != flat.outputs.size(); i++) {
+            outmap[flat.outputs[i]][i] = true;
         }
 
-        for(int i=nodes_sorted.size()-1; i >= 0; i--) {
-            node_t* n = nodes_sorted[i];
-            int index = n->get_index();
-            for(unsigned j=0; j != n->num_fanouts(); j++) {
-                or_bitmap(outmap[index], outmap[n->fanouts[j]->get_index()]);
+        for(int i=flat.order.size()-1; i >= 0; i--) {
+            unsigned index = flat.order[i];
+            const unsigned* fo = flat.fanouts_of(index);
+            for(unsigned j=0, m=flat.num_fanouts(index); j != m; j++) {
+                or_bitmap(outmap[index], outmap[fo[j]]);
             }
         }
     }
@@ -1225,6 +1409,7 @@ namespace ckt_n {
     void ckt_t::add_ckt_input(node_t* ci)
     {
         assert(!ci->is_keyinput());
+        ci->level = 0;
         nodes.push_back(ci);
         inputs.push_back(ci);
         ckt_inputs.push_back(ci);
@@ -1241,6 +1426,7 @@ namespace ckt_n {
     void ckt_t::add_key_input(node_t* ki)
     {
         assert(ki->is_keyinput());
+        ki->level = 0;
         nodes.push_back(ki);
         inputs.push_back(ki);
         key_inputs.push_back(ki);
@@ -1263,6 +1449,7 @@ namespace ckt_n {
 
         ki->add_fanout(kg);
         n->add_fanout(kg);
+        update_levels(kg);
     }
 
     node_t* ckt_t::insert_mux_key_gate(node_t* ki, node_t* n)
@@ -1285,6 +1472,7 @@ namespace ckt_n {
 
         ki->add_fanout(kg);
         n->add_fanout(kg);
+        update_levels(kg);
         return kg;
     }
 
@@ -1327,6 +1515,7 @@ namespace ckt_n {
 
                 kg->add_input(inv);
                 inv->add_fanout(kg);
+                inv->level = 1;
             }
         } else {
             n->rewrite_fanouts_with(kg);
@@ -1339,6 +1528,7 @@ namespace ckt_n {
                 n->func = get_inv_func(n->func);
             }
         }
+        update_levels(kg);
     }
 
     void ckt_t::add_gate(node_t* g)
@@ -1499,8 +1689,10 @@ namespace ckt_n {
             assert(pos_n != nm_fwd.end());
             node_t* n_pr  = pos_n->second;
 
-            // now we want to double this circuit.
-            dblckt_t dbl(cs, dup_allkeys, true);
+            // now we want to double this circuit. n_pr is inverted in one
+            // copy, so it mustn't be shared.
+            dup_keysAndNodes_t dup(n_pr);
+            dblckt_t dbl(cs, dup, true);
             // n_p2 is the node we are going to invert in the doubled ckt.
             node_t* n_p2 = dbl.getB(n_pr);
 
@@ -1536,13 +1728,11 @@ namespace ckt_n {
 
         using namespace sat_n;
         Solver S;
-        node2var_map_t nm1, nm2;
+        index2var_map_t nm1, nm2;
         Lit y = create_slice_diff(S, out, n, internals, inputs, nm1, nm2);
 
-        assert(nm1.find(n) != nm1.end());
-        assert(nm2.find(n) != nm2.end());
-        Lit l1 = mkLit(nm1[n]);
-        Lit l2 = mkLit(nm2[n]);
+        Lit l1 = mkLit(node_var(nm1, n));
+        Lit l2 = mkLit(node_var(nm2, n));
 
         vec_lit_t assumps;
         assumps.push(y);
@@ -2009,38 +2199,127 @@ namespace ckt_n {
         return false;
     } 
 
+    namespace {
+	// buffered reader for .stoch files; whitespace-separated tokens, or
+	// whole lines for the header, with the line number for messages
+	struct stoch_reader_t {
+		FILE* fp;
+		std::vector<char> buf;
+		size_t pos, len;
+		unsigned line;
+
+		stoch_reader_t(FILE* f) : fp(f), buf(1 << 20), pos(0), len(0), line(1) {}
+
+		int peek() {
+			if (pos == len) {
+				len = fread(&buf[0], 1, buf.size(), fp);
+				pos = 0;
+				if (len == 0) {
+					return EOF;
+				}
+			}
+			return (unsigned char) buf[pos];
+		}
+		int get() {
+			int c = peek();
+			if (c != EOF) {
+				pos++;
+				if (c == '\n') {
+					line++;
+				}
+			}
+			return c;
+		}
+
+		// the rest of the current line, without the newline
+		bool next_line(std::string& s) {
+			s.clear();
+			int c = get();
+			if (c == EOF) {
+				return false;
+			}
+			while (c != EOF && c != '\n') {
+				s.push_back((char) c);
+				c = get();
+			}
+			return true;
+		}
+
+		// the next token; tok_line is the line it starts on
+		bool next(std::string& tok, unsigned& tok_line) {
+			tok.clear();
+			int c;
+			while ((c = peek()) != EOF && isspace(c)) {
+				get();
+			}
+			if (c == EOF) {
+				return false;
+			}
+			tok_line = line;
+			while ((c = peek()) != EOF && !isspace(c)) {
+				tok.push_back((char) get());
+			}
+			return true;
+		}
+	};
+
+	fct _get_poly_fct(const std::string& name) {
+		if (name == "AND") return fct::AND;
+		else if (name == "NAND") return fct::NAND;
+		else if (name == "OR") return fct::OR;
+		else if (name == "NOR") return fct::NOR;
+		else if (name == "XOR") return fct::XOR;
+		else if (name == "XNOR") return fct::XNOR;
+		else if (name == "INV") return fct::INV;
+		else if (name == "BUF") return fct::BUF;
+		else return fct::UNDEF;
+	}
+
+	bool _parse_percentage(const std::string& file, unsigned line, const std::string& tok, double& value) {
+		char* end;
+		value = strtod(tok.c_str(), &end);
+		if (tok.empty() || *end != '\0') {
+			std::cout << "Parsing of " << file << ", line " << line << "; expected a number but found \"" << tok << "\"" << std::endl;
+			return false;
+		}
+		return true;
+	}
+    }
+
     // JOHANN
     void ckt_t::readStochFile(std::string file) {
-	std::ifstream in;
-	node_t* gate;
 	std::string drop;
 	std::string sampling_flag;
+	std::string header;
 	std::string gate_name;
-	std::string error_rate;
-	std::string polymorphic_gate__function;
-	std::string polymorphic_gate__probability;
+	std::string tok;
+	unsigned line, gate_line;
 	unsigned stochastic_gates = 0;
 
-	in.open(file.c_str());
+	// gates listed in the file but not in the circuit; reported once the whole file is read
+	std::vector< std::pair<std::string, unsigned> > unknown_gates;
 
-	if (!in.good()) {
-		std::cout << std::endl;
-		std::cout << "No such stochastic definition file: " << file << std::endl;
-		std::cout << "Circuit will behave fully deterministic" << std::endl;
-		std::cout << std::endl;
+	FILE* fp = fopen(file.c_str(), "r");
+	if (fp == NULL) {
+		this->stochastic_gates = -1;
 		return;
 	}
+	stoch_reader_t in(fp);
+
+	// name index for the gates
+	map_t name_map;
+	init_node_map(name_map);
+
+	// drop header; the comment line
+	// # OUTPUT_SAMPLING_ON OUTPUT_SAMPLING_ITERATIONS OUTPUT_SAMPLING_FOR_TEST_ON TEST_PATTERNS [OUTPUT_SAMPLING_ADAPTIVE_ON OUTPUT_SAMPLING_ADAPTIVE_ERROR]
+	in.next_line(drop);
 
-	// drop header; five words
-	// # OUTPUT_SAMPLING_ON OUTPUT_SAMPLING_ITERATIONS OUTPUT_SAMPLING_FOR_TEST_ON TEST_PATTERNS
-	in >> drop;
-	in >> drop;
-	in >> drop;
-	in >> drop;
-	in >> drop;
+	// the values are all on the next line; the adaptive-sampling values are optional
+	in.next_line(header);
+	std::istringstream header_in(header);
 
 	// parse sampling flag; if true sample multiple output observations for one particular input pattern, and subsequently pick the most common pattern as ground truth
-	in >> sampling_flag;
+	header_in >> sampling_flag;
 
 	if (sampling_flag == "1" || sampling_flag == "true") {
 		IO_sampling_flag = true;
@@ -2050,10 +2329,10 @@ namespace ckt_n {
 	}
 
 	// parse sampling iterations
-	in >> IO_sampling_iter;
+	header_in >> IO_sampling_iter;
 
 	// parse sampling flag for test phase; if true also sample output observations for testing 
-	in >> sampling_flag;
+	header_in >> sampling_flag;
 
 	if (sampling_flag == "1" || sampling_flag == "true") {
 		IO_sampling_for_test_flag = true;
@@ -2063,101 +2342,85 @@ namespace ckt_n {
 	}
 
 	// parse test patterns 
-	in >> test_patterns;
+	header_in >> test_patterns;
+
+	// parse adaptive sampling flag; if true, stop sampling as soon as the most common pattern is statistically decided
+	if (header_in >> sampling_flag) {
+
+		if (sampling_flag == "1" || sampling_flag == "true") {
+			IO_sampling_adaptive_flag = true;
+		}
+		else {
+			IO_sampling_adaptive_flag = false;
+		}
+
+		// parse the error probability (%) for adaptive sampling
+		double error;
+		if (header_in >> error) {
+			if (error <= 0.0 || error >= 100.0) {
+				std::cout << "Parsing of " << file << "; error probability for adaptive sampling has to be within (0, 100) %: " << error << std::endl;
+				exit(1);
+			}
+			IO_sampling_adaptive_error = error;
+		}
+	}
 
 	// drop header; until keyword NEXT_GATE
-	do {
-		in >> drop;
-	} while (drop != "NEXT_GATE");
+	while (in.next(tok, line) && tok != "NEXT_GATE");
 
-	// parse stochastic gates
+	// parse stochastic gates; each one is
+	// GATE_NAME ERROR_RATE [POLYMORPHIC_GATE FCT_1 PROBABILITY_1 ... FCT_n PROBABILITY_n] NEXT_GATE
 	//
-	while (!in.eof()) {
-		in >> gate_name;
-		in >> error_rate;
-
-		if (in.eof()) {
-			break;
+	bool more = in.next(gate_name, gate_line);
+	while (more) {
+		node_t* gate = nullptr;
+		map_t::iterator pos = name_map.find(gate_name);
+		if (pos != name_map.end() && pos->second->is_gate()) {
+			gate = pos->second;
 		}
 
-		gate = nullptr;
-		for (auto* g : gates) {
-			if (g->name == gate_name) {
-				gate = g;
-				stochastic_gates++;
-				break;
-			}
+		if (!in.next(tok, line)) {
+			std::cout << "Parsing of " << file << ", line " << gate_line << "; missing error rate for gate " << gate_name << std::endl;
+			exit(1);
 		}
 
 		if (gate == nullptr) {
-			std::cout << "Parsing of " << file << "; no such gate exists in the circuit: " << gate_name << std::endl;
-
-			// drop list of polymorphic functions, if there is one, for gate not found
-			do {
-				in >> drop;
+			unknown_gates.push_back(std::make_pair(gate_name, gate_line));
 
-				if (in.eof()) {
-					break;
-				}
-			} while (drop != "NEXT_GATE");
+			// drop the rest of the definition, including a list of polymorphic functions
+			while ((more = in.next(tok, line)) && tok != "NEXT_GATE");
 		}
 		else {
-			gate->error_rate = atof(error_rate.c_str());
+			stochastic_gates++;
+
+			double error_rate;
+			if (!_parse_percentage(file, line, tok, error_rate)) {
+				exit(1);
+			}
+			gate->error_rate = error_rate;
 
 			if (ckt_t::DBG) {
 				std::cout << "Parsing of " << file << "; gate " << gate_name << " annotated with error rate of " << gate->error_rate << "%" << std::endl;
 			}
 
 			// next word is keyword, either NEXT_GATE or POLYMORPHIC_GATE
-			in >> drop;
+			more = in.next(tok, line);
 
 			// don't check for POLYMORPHIC_GATE, but rather check only that it's not NEXT_GATE; this way, any typo in POLYMORPHIC_GATE is not an issue
-			if (drop != "NEXT_GATE") {
-
-				// parse list of polymorphic functions
-				do {
-					// polymorphic functions are always in pairs; if NEXT_GATE occurs, the list of functions ended already
-					//
-					in >> polymorphic_gate__function;
-					if (in.eof() || polymorphic_gate__function == "NEXT_GATE") {
-						break;
-					}
-					in >> polymorphic_gate__probability;
-					if (in.eof()) {
-						break;
-					}
+			if (more && tok != "NEXT_GATE") {
 
+				// parse list of polymorphic functions; they are always in pairs, and NEXT_GATE or the end of the file ends the list
+				while ((more = in.next(tok, line)) && tok != "NEXT_GATE") {
 					poly_fct p_fct;
+					p_fct.name = tok;
+					p_fct.function = _get_poly_fct(p_fct.name);
 
-					p_fct.probability = atof(polymorphic_gate__probability.c_str());
-					p_fct.name = polymorphic_gate__function;
-
-					if (p_fct.name == "AND") {
-						p_fct.function = fct::AND;
-					}
-					else if (p_fct.name == "NAND") {
-						p_fct.function = fct::NAND;
-					}
-					else if (p_fct.name == "OR") {
-						p_fct.function = fct::OR;
-					}
-					else if (p_fct.name == "NOR") {
-						p_fct.function = fct::NOR;
+					if (!in.next(tok, line)) {
+						std::cout << "Parsing of " << file << ", line " << line << "; missing probability for polymorphic function " << p_fct.name << " of gate " << gate_name << std::endl;
+						exit(1);
 					}
-					else if (p_fct.name == "XOR") {
-						p_fct.function = fct::XOR;
-					}
-					else if (p_fct.name == "XNOR") {
-						p_fct.function = fct::XNOR;
-					}
-					else if (p_fct.name == "INV") {
-						p_fct.function = fct::INV;
-					}
-					else if (p_fct.name == "BUF") {
-						p_fct.function = fct::BUF;
-					}
-					else {
-						p_fct.function = fct::UNDEF;
+					if (!_parse_percentage(file, line, tok, p_fct.probability)) {
+						exit(1);
 					}
 
 					gate->polymorphic_fcts.push_back(p_fct);
@@ -2165,32 +2428,59 @@ namespace ckt_n {
 					if (ckt_t::DBG) {
 						std::cout << "Parsing of " << file << "; gate " << gate_name << " has polymorphic function \"" << p_fct.name << "\"; probability for that function is " << p_fct.probability << "%" << std::endl;
 					}
-
-				} while (true);
+				}
 
 				if (ckt_t::DBG) {
 					std::cout << "Parsing of " << file << "; gate " << gate_name << " has in total " << gate->polymorphic_fcts.size() << " polymorphic functions" << std::endl;
 				}
 			}
 		}
+
+		more = more && in.next(gate_name, gate_line);
 	}
-	std::cout << "Stochastic gates count: " << stochastic_gates << std::endl;
+	fclose(fp);
+
+	if (!unknown_gates.empty()) {
+		const unsigned MAX_LISTED = 10;
+		std::cout << "Error: parsing of " << file << "; " << unknown_gates.size() << " gate(s) don't exist in the circuit, their definitions are ignored:" << std::endl;
+		for (unsigned i = 0; i != unknown_gates.size() && i != MAX_LISTED; i++) {
+			std::cout << "  " << unknown_gates[i].first << " (line " << unknown_gates[i].second << ")" << std::endl;
+		}
+		if (unknown_gates.size() > MAX_LISTED) {
+			std::cout << "  ... and " << (unknown_gates.size() - MAX_LISTED) << " more" << std::endl;
+		}
+	}
+
+	this->stochastic_gates = stochastic_gates;
 
 	// in case no stochastic gates was defined, sampling of output patterns is superfluous
 	//
 	if (stochastic_gates == 0) {
 		IO_sampling_flag = false;
 	}
+    }
+
+    void ckt_t::print_stoch_summary(const std::string& file) const {
+	if (stochastic_gates < 0) {
+		std::cout << std::endl;
+		std::cout << "No such stochastic definition file: " << file << std::endl;
+		std::cout << "Circuit will behave fully deterministic" << std::endl;
+		std::cout << std::endl;
+		return;
+	}
+
+	std::cout << "Stochastic gates count: " << stochastic_gates << std::endl;
 
 	std::cout << "Sampling of output observations for stochastic circuits: ";
 	if (IO_sampling_flag) {
 		std::cout << "on" << std::endl;
 		std::cout << " Sampling iterations (for each pattern): " << IO_sampling_iter << std::endl;
+		if (IO_sampling_adaptive_flag) {
+			std::cout << " Adaptive sampling: on; error probability: " << IO_sampling_adaptive_error << " %" << std::endl;
+		}
 	}
 	else {
 		std::cout << "off" << std::endl;
 	}
-
-	in.close();
     }
 }
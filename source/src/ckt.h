@@ -5,9 +5,12 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
 
 #include "node.h"
-#include "ast.h"
+#include "flatckt.h"
+#include "benchfile.h"
+#include "cktcache.h"
 #include "sat.h"
 #include "allsatckt.h"
 #include "SATInterface.h"
@@ -21,8 +24,9 @@ namespace ckt_n {
 	    // JOHANN
 	    static constexpr bool DBG = false;
 
-        typedef std::map<std::string, node_t*> map_t;
+        typedef std::unordered_map<std::string, node_t*> map_t;
         typedef std::map<node_t*, node_t*> node_map_t;
+        typedef std::unordered_map<bench_file_t::span_t, node_t*, bench_file_t::span_hash_t> span_map_t;
 
         nodelist_t inputs;
         nodelist_t ckt_inputs;
@@ -33,6 +37,8 @@ namespace ckt_n {
         nodelist_t nodes;
         nodelist_t gates_sorted;
         nodelist_t nodes_sorted;
+        // index-based copy of the circuit, made by topo_sort.
+        flatckt_t flat;
 
 	    // JOHANN
 	    //
@@ -44,8 +50,14 @@ namespace ckt_n {
 	    unsigned IO_sampling_iter = 1e03;
 	    bool IO_sampling_for_test_flag = false;
 	    unsigned test_patterns = 1e03;
-
-        ckt_t(ast_n::statements_t& stms);           // constructor from bench file.
+	    // stop sampling as soon as the most common pattern is decided to be dominant (or not), with an error probability given in %
+	    bool IO_sampling_adaptive_flag = false;
+	    double IO_sampling_adaptive_error = 1.0;
+	    // number of gates annotated by the .stoch file; -1 if there was no such file
+	    int stochastic_gates = -1;
+
+        ckt_t(const bench_file_t& bench);           // constructor from bench file.
+        ckt_t(const ckt_cache_t& cache);            // constructor from a binary image.
         ckt_t(nodepair_list_t& pair_map);           // circuit doubling constructor.
         ckt_t(const ckt_t& c1, const ckt_t& c2);    // circuit comparison constructor.
         ckt_t(const ckt_t& c1, node_map_t& nm);     // copy constructor.
@@ -105,8 +117,8 @@ namespace ckt_n {
             node_t* diff,
             const nodeset_t& internals,
             const nodeset_t& inputs,
-            node2var_map_t& n2v1,
-            node2var_map_t& n2v2
+            index2var_map_t& n2v1,
+            index2var_map_t& n2v2
         );
 
         void init_input_map(index2lit_map_t& mappings, std::vector<bool>& inputs) const;
@@ -123,7 +135,13 @@ namespace ckt_n {
         unsigned num_gates() const { return gates.size(); }
         unsigned num_nodes() const { return nodes.size(); }
 
+        // compute the levels and sort the nodes and gates by level, in
+        // linear time; also rebuilds the flat copy.
         void topo_sort();
+        // recompute the level of n and update the levels in its fanout cone
+        // after an edit. the sorted lists and the flat copy still need a
+        // topo_sort.
+        void update_levels(node_t* n);
         void init_keymap(std::vector< std::vector<bool> >& keymap);
         void init_outputmap(std::vector< std::vector<bool> >& outmap);
 
@@ -148,6 +166,7 @@ namespace ckt_n {
         // Insert a key gate at the output of this node.
         // This key gate is controlled by the key input 'ki'.
         // val is the correct value of the key input.
+        // The insert functions keep the levels up to date.
         void insert_key_gate(node_t* n, node_t* ki, int val);
         node_t* insert_mux_key_gate(node_t* ki, node_t* n);
         void insert_2inp_key_gate(node_t* ki, node_t* n, const std::string& func);
@@ -185,11 +204,12 @@ namespace ckt_n {
 
 	// JOHANN
 	void readStochFile(std::string file);
+	void print_stoch_summary(const std::string& file) const;
 	
     private:
-        void _init_map(map_t& map, ast_n::statements_t& stms);
-        void _init_inputs(map_t& map, ast_n::statements_t& stms);
-        void _init_outputs(map_t& map, ast_n::statements_t& stms);
+        void _init_map(span_map_t& map, const bench_file_t& bench);
+        void _init_inputs(span_map_t& map, const bench_file_t& bench);
+        void _init_outputs(span_map_t& map, const bench_file_t& bench);
         void _init_fanouts();
         void _init_indices();
         void _copy_array(const node_map_t& nm, const nodelist_t& in_array, nodelist_t& out_array);
@@ -202,6 +222,9 @@ namespace ckt_n {
         void _compare_outputs(node_map_t& nm, const nodelist_t& o1, const nodelist_t& o2);
         void _compute_gate_prob( node_t* ni, std::vector<double>& ps );
 
+        static int _compute_level(const node_t* n);
+        static void _sort_by_level(const nodelist_t& in, nodelist_t& out, int max_level);
+
         void _split_gate(node_t* g);
         node_t* _create_gate(nodelist_t& inputs, const std::string& type, const std::string& name);
 
@@ -0,0 +1,333 @@
+#include "cktcache.h"
+#include "ckt.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <assert.h>
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+namespace ckt_n {
+
+    namespace {
+        const char     CACHE_MAGIC[8] = { 'P', 'S', 'A', 'T', 'C', 'K', 'T', '\0' };
+        const uint32_t CACHE_VERSION = 1;
+
+        size_t _align(size_t sz) { return (sz + 7) & ~((size_t) 7); }
+
+        std::string _real_path(const std::string& file)
+        {
+            char buf[PATH_MAX];
+            if(file.size() && realpath(file.c_str(), buf) != NULL) {
+                return std::string(buf);
+            }
+            return file;
+        }
+
+        void _get_stamp(const std::string& file, ckt_cache_t::stamp_t& stamp)
+        {
+            struct stat st;
+            memset(&stamp, 0, sizeof(stamp));
+            if(file.size() && stat(file.c_str(), &st) == 0) {
+                stamp.size = st.st_size;
+                stamp.mtime_sec = st.st_mtim.tv_sec;
+                stamp.mtime_nsec = st.st_mtim.tv_nsec;
+                stamp.exists = 1;
+            }
+        }
+
+        std::string _source_paths(const std::string& bench_file, const std::string& stoch_file)
+        {
+            std::string paths = _real_path(bench_file);
+            paths.push_back('\0');
+            paths += _real_path(stoch_file);
+            paths.push_back('\0');
+            return paths;
+        }
+
+        // appends sections to the image, each aligned to 8 bytes.
+        struct writer_t {
+            std::vector<char> buf;
+
+            template<class T> void put(const T* data, size_t count) {
+                size_t pos = buf.size();
+                size_t bytes = count * sizeof(T);
+                buf.resize(_align(pos + bytes), 0);
+                if(bytes) memcpy(&buf[pos], data, bytes);
+            }
+            template<class T> void put(const std::vector<T>& v) {
+                put(v.size() ? &v[0] : (const T*) NULL, v.size());
+            }
+        };
+
+        // walks the sections of a mapped image.
+        struct reader_t {
+            const char* base;
+            size_t      size;
+            size_t      pos;
+
+            template<class T> bool get(const T*& ptr, size_t count) {
+                size_t bytes = count * sizeof(T);
+                if(pos + bytes > size) return false;
+                ptr = (const T*) (base + pos);
+                pos = _align(pos + bytes);
+                return true;
+            }
+        };
+    }
+
+    ckt_cache_t::ckt_cache_t()
+        : header(NULL)
+        , map_addr(NULL)
+        , map_size(0)
+    {
+    }
+
+    ckt_cache_t::~ckt_cache_t()
+    {
+        close();
+    }
+
+    void ckt_cache_t::close()
+    {
+        if(map_addr != NULL) {
+            munmap(map_addr, map_size);
+            map_addr = NULL;
+            map_size = 0;
+        }
+        header = NULL;
+    }
+
+    std::string ckt_cache_t::cache_path(
+        const std::string& dir,
+        const std::string& bench_file,
+        const std::string& stoch_file)
+    {
+        if(dir.size() == 0) {
+            return (stoch_file.size() ? stoch_file : bench_file) + ".ckt";
+        }
+
+        // the images of all circuits go into the same directory, so the
+        // name gets a hash of the source paths.
+        std::string paths = _source_paths(bench_file, stoch_file);
+        uint64_t h = 14695981039346656037ULL;
+        for(unsigned i=0; i != paths.size(); i++) {
+            h = (h ^ (unsigned char) paths[i]) * 1099511628211ULL;
+        }
+
+        std::string base = bench_file;
+        size_t slash = base.rfind('/');
+        if(slash != std::string::npos) {
+            base = base.substr(slash+1);
+        }
+
+        std::ostringstream out;
+        out << dir << "/" << base << "-" << std::hex << std::setw(16) << std::setfill('0') << h << ".ckt";
+        return out.str();
+    }
+
+    bool ckt_cache_t::load(
+        const std::string& cache_file,
+        const std::string& bench_file,
+        const std::string& stoch_file)
+    {
+        close();
+
+        int fd = open(cache_file.c_str(), O_RDONLY);
+        if(fd == -1) {
+            return false;
+        }
+        struct stat st;
+        if(fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(header_t)) {
+            ::close(fd);
+            return false;
+        }
+        void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if(addr == MAP_FAILED) {
+            return false;
+        }
+        map_addr = addr;
+        map_size = st.st_size;
+
+        reader_t r = { (const char*) map_addr, map_size, 0 };
+        if(!r.get(header, 1) ||
+           memcmp(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+           header->version != CACHE_VERSION)
+        {
+            close();
+            return false;
+        }
+
+        // the image must have been made from the same, unmodified files.
+        stamp_t bench_stamp, stoch_stamp;
+        _get_stamp(bench_file, bench_stamp);
+        _get_stamp(stoch_file, stoch_stamp);
+        std::string src = _source_paths(bench_file, stoch_file);
+        const header_t& h = *header;
+        if(!bench_stamp.exists ||
+           memcmp(&bench_stamp, &h.bench_stamp, sizeof(stamp_t)) != 0 ||
+           memcmp(&stoch_stamp, &h.stoch_stamp, sizeof(stamp_t)) != 0 ||
+           h.num_path_chars != src.size() ||
+           !r.get(paths, h.num_path_chars) ||
+           memcmp(paths, src.c_str(), src.size()) != 0)
+        {
+            close();
+            return false;
+        }
+
+        unsigned n = h.num_nodes;
+        bool ok =
+            r.get(functions, n) &&
+            r.get(flags, n) &&
+            r.get(levels, n) &&
+            r.get(fanin_begin, n+1) &&
+            r.get(fanins, h.num_fanins) &&
+            r.get(fanout_begin, n+1) &&
+            r.get(fanouts, h.num_fanouts) &&
+            r.get(name_begin, n+1) &&
+            r.get(names, h.num_name_chars) &&
+            r.get(func_begin, n+1) &&
+            r.get(funcs, h.num_func_chars) &&
+            r.get(order, n) &&
+            r.get(gate_order, h.num_gates) &&
+            r.get(ckt_inputs, h.num_ckt_inputs) &&
+            r.get(key_inputs, h.num_key_inputs) &&
+            r.get(outputs, h.num_outputs) &&
+            r.get(error_rates, n) &&
+            r.get(poly_begin, n+1) &&
+            r.get(polys, h.num_polys) &&
+            r.get(poly_names, h.num_poly_chars) &&
+            r.pos == map_size;
+        if(!ok) {
+            close();
+            return false;
+        }
+
+        madvise(map_addr, map_size, MADV_SEQUENTIAL);
+        return true;
+    }
+
+    bool ckt_cache_t::save(
+        const std::string& cache_file,
+        const ckt_t& ckt,
+        const std::string& bench_file,
+        const std::string& stoch_file)
+    {
+        const flatckt_t& flat = ckt.flat;
+        unsigned n = ckt.num_nodes();
+        if(flat.num_nodes() != n) {
+            std::cerr << "Warning: the circuit of " << bench_file
+                      << " isn't levelized, not caching it." << std::endl;
+            return false;
+        }
+
+        std::vector<uint32_t> functions(n), func_begin(n+1), poly_begin(n+1);
+        std::vector<char> funcs, poly_names;
+        std::vector<double> error_rates(n);
+        std::vector<poly_t> polys;
+        for(unsigned i=0; i != n; i++) {
+            const node_t* nd = ckt.nodes[i];
+            functions[i] = (uint32_t) flat.functions[i];
+            func_begin[i] = funcs.size();
+            funcs.insert(funcs.end(), nd->func.begin(), nd->func.end());
+            funcs.push_back('\0');
+            error_rates[i] = nd->error_rate;
+            poly_begin[i] = polys.size();
+            for(unsigned j=0; j != nd->polymorphic_fcts.size(); j++) {
+                const poly_fct& pf = nd->polymorphic_fcts[j];
+                poly_t p;
+                p.function = (uint32_t) pf.function;
+                p.name_begin = poly_names.size();
+                p.probability = pf.probability;
+                polys.push_back(p);
+                poly_names.insert(poly_names.end(), pf.name.begin(), pf.name.end());
+                poly_names.push_back('\0');
+            }
+        }
+        func_begin[n] = funcs.size();
+        poly_begin[n] = polys.size();
+
+        std::string src = _source_paths(bench_file, stoch_file);
+
+        header_t h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        h.version = CACHE_VERSION;
+        h.num_nodes = n;
+        h.num_gates = flat.gate_order.size();
+        h.num_fanins = flat.fanins.size();
+        h.num_fanouts = flat.fanouts.size();
+        h.num_name_chars = flat.names.size();
+        h.num_func_chars = funcs.size();
+        h.num_ckt_inputs = flat.ckt_inputs.size();
+        h.num_key_inputs = flat.key_inputs.size();
+        h.num_outputs = flat.outputs.size();
+        h.num_polys = polys.size();
+        h.num_poly_chars = poly_names.size();
+        h.num_path_chars = src.size();
+        _get_stamp(bench_file, h.bench_stamp);
+        _get_stamp(stoch_file, h.stoch_stamp);
+        h.stochastic_gates = ckt.stochastic_gates;
+        h.IO_sampling_flag = ckt.IO_sampling_flag;
+        h.IO_sampling_iter = ckt.IO_sampling_iter;
+        h.IO_sampling_for_test_flag = ckt.IO_sampling_for_test_flag;
+        h.test_patterns = ckt.test_patterns;
+        h.IO_sampling_adaptive_flag = ckt.IO_sampling_adaptive_flag;
+        h.IO_sampling_adaptive_error = ckt.IO_sampling_adaptive_error;
+
+        writer_t w;
+        w.put(&h, 1);
+        w.put(src.c_str(), src.size());
+        w.put(functions);
+        w.put(flat.flags);
+        w.put(flat.levels);
+        w.put(flat.fanin_begin);
+        w.put(flat.fanins);
+        w.put(flat.fanout_begin);
+        w.put(flat.fanouts);
+        w.put(flat.name_begin);
+        w.put(flat.names);
+        w.put(func_begin);
+        w.put(funcs);
+        w.put(flat.order);
+        w.put(flat.gate_order);
+        w.put(flat.ckt_inputs);
+        w.put(flat.key_inputs);
+        w.put(flat.outputs);
+        w.put(error_rates);
+        w.put(poly_begin);
+        w.put(polys);
+        w.put(poly_names);
+
+        std::ostringstream tmp;
+        tmp << cache_file << ".tmp." << getpid();
+        std::string tmp_file = tmp.str();
+        {
+            std::ofstream out(tmp_file.c_str(), std::ios::binary);
+            if(out) {
+                out.write(&w.buf[0], w.buf.size());
+            }
+            if(!out) {
+                std::cerr << "Warning: unable to write the circuit cache " << tmp_file << "." << std::endl;
+                unlink(tmp_file.c_str());
+                return false;
+            }
+        }
+        if(rename(tmp_file.c_str(), cache_file.c_str()) != 0) {
+            perror(cache_file.c_str());
+            unlink(tmp_file.c_str());
+            return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,129 @@
+#ifndef _CKTCACHE_H_DEFINED_
+#define _CKTCACHE_H_DEFINED_
+
+#include <string>
+#include <stdint.h>
+#include "node.h"
+
+namespace ckt_n {
+    struct ckt_t;
+
+    // Binary image of a parsed and levelized circuit.
+    //
+    // The image holds the same arrays as flatckt_t (CSR fan-ins/fan-outs,
+    // interned names, level order) plus the gate function strings and the
+    // annotations from the .stoch file, so that a circuit can be rebuilt
+    // without parsing, without a name map and without topo_sort. The file
+    // is memory-mapped and the arrays are used in place.
+    //
+    // The image records the size and modification time of the .bench and
+    // the .stoch file it was made from; load fails if either has changed,
+    // and the caller is expected to parse the files and save a new image.
+    struct ckt_cache_t {
+        // per-node data of a polymorphic function.
+        struct poly_t {
+            uint32_t    function;
+            uint32_t    name_begin;
+            double      probability;
+        };
+
+        // stat() of a source file, to detect changes.
+        struct stamp_t {
+            int64_t     size;
+            int64_t     mtime_sec;
+            int64_t     mtime_nsec;
+            int64_t     exists;
+        };
+
+        struct header_t {
+            char        magic[8];
+            uint32_t    version;
+            uint32_t    num_nodes;
+            uint32_t    num_gates;
+            uint32_t    num_fanins;
+            uint32_t    num_fanouts;
+            uint32_t    num_name_chars;
+            uint32_t    num_func_chars;
+            uint32_t    num_ckt_inputs;
+            uint32_t    num_key_inputs;
+            uint32_t    num_outputs;
+            uint32_t    num_polys;
+            uint32_t    num_poly_chars;
+            uint32_t    num_path_chars;
+            stamp_t     bench_stamp;
+            stamp_t     stoch_stamp;
+
+            // the .stoch settings of ckt_t.
+            int32_t     stochastic_gates;
+            uint32_t    IO_sampling_flag;
+            uint32_t    IO_sampling_iter;
+            uint32_t    IO_sampling_for_test_flag;
+            uint32_t    test_patterns;
+            uint32_t    IO_sampling_adaptive_flag;
+            double      IO_sampling_adaptive_error;
+        };
+
+        const header_t* header;
+        // the source file paths, for checking against hash collisions.
+        const char*     paths;
+        const uint32_t* functions;
+        const uint8_t*  flags;
+        const uint32_t* levels;
+        const uint32_t* fanin_begin;
+        const uint32_t* fanins;
+        const uint32_t* fanout_begin;
+        const uint32_t* fanouts;
+        const uint32_t* name_begin;
+        const char*     names;
+        const uint32_t* func_begin;
+        const char*     funcs;
+        const uint32_t* order;
+        const uint32_t* gate_order;
+        const uint32_t* ckt_inputs;
+        const uint32_t* key_inputs;
+        const uint32_t* outputs;
+        const double*   error_rates;
+        const uint32_t* poly_begin;
+        const poly_t*   polys;
+        const char*     poly_names;
+
+        ckt_cache_t();
+        ~ckt_cache_t();
+
+        // name of the image for the given .bench and .stoch file (which
+        // may be empty). with an empty dir, the image is put next to the
+        // .stoch file, or the .bench file if there is no .stoch file.
+        static std::string cache_path(
+            const std::string& dir,
+            const std::string& bench_file,
+            const std::string& stoch_file);
+
+        // map an image. returns false if it doesn't exist, is corrupt or
+        // out of date with respect to the source files.
+        bool load(
+            const std::string& cache_file,
+            const std::string& bench_file,
+            const std::string& stoch_file);
+        void close();
+
+        // write the image of a circuit created from the given source
+        // files. the file is written under a temporary name and renamed,
+        // so concurrent runs never see a partial image. errors are only
+        // reported, as the cache is optional.
+        static bool save(
+            const std::string& cache_file,
+            const ckt_t& ckt,
+            const std::string& bench_file,
+            const std::string& stoch_file);
+
+    private:
+        void*       map_addr;
+        size_t      map_size;
+
+        // not copyable, the arrays point into the mapping.
+        ckt_cache_t(const ckt_cache_t&);
+        ckt_cache_t& operator=(const ckt_cache_t&);
+    };
+}
+
+#endif
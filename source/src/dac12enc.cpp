@@ -5,12 +5,12 @@
 namespace ckt_n
 {
     dac12enc_t::dac12enc_t(
-        ast_n::statements_t& stms, 
+        const bench_file_t& bench, 
         const std::string& graphFile, 
         const std::string& cliqueFile, 
         double key_fraction
     )
-        : ckt(stms)
+        : ckt(bench)
     {
         target_keys = int((ckt.num_gates() * key_fraction) + 0.5);
 
@@ -2,7 +2,7 @@
 #define _DAC12ENC_H_DEFINED_
 
 #include "ckt.h"
-#include "ast.h"
+#include "benchfile.h"
 #include <iostream>
 #include <list>
 #include <set>
@@ -29,7 +29,7 @@ namespace ckt_n {
         int _get_wt(node_t* n1, node_t* n2);
         int _get_wt(node_t* n1, const nodeset_t& ns);
     public:
-        dac12enc_t(ast_n::statements_t& stms, const std::string& graphFile, const std::string& cliqueFile, double fraction);
+        dac12enc_t(const bench_file_t& bench, const std::string& graphFile, const std::string& cliqueFile, double fraction);
         virtual ~dac12enc_t();
 
         void write(std::ostream& out) {
@@ -17,18 +17,33 @@ namespace ckt_n {
         return (n == k1) || (n == k2);
     }
 
+    bool dup_keysAndNodes_t::shouldDup(node_t* n) {
+        // the other inputs are shared, as with dup_allkeys.
+        if(n->is_input()) return n->is_keyinput();
+        if(nodes.find(n) != nodes.end()) return true;
+        for(unsigned i=0; i != n->num_inputs(); i++) {
+            if(n->inputs[i]->is_input() && nodes.find(n->inputs[i]) != nodes.end()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
 
     dblckt_t::dblckt_t(ckt_t& c, dup_interface_t& interface, bool compare_outputs)
         : ckt(c)
     {
         pair_map.resize(c.nodes.size());
+        std::vector<bool> dup;
+        _init_dup_flags(interface, dup);
+
         // deal with the inputs first.
         for(unsigned i=0; i != c.num_inputs(); i++) {
             node_t* inp = c.inputs[i];
             int index = inp->get_index();
             assert(index >= 0 && index < (int) pair_map.size());
 
-            if(!interface.shouldDup(inp)) {
+            if(!dup[index]) {
                 pair_map[index].first = node_t::create_input(inp->name);
                 pair_map[index].second = pair_map[index].first;
             } else {
@@ -45,10 +60,16 @@ namespace ckt_n {
             int index = g->get_index();
             assert(index >= 0 && index < (int) pair_map.size());
 
-            pair_map[index].first = 
-                node_t::create_gate(g->name + "_A", g->func);
-            pair_map[index].second = 
-                node_t::create_gate(g->name + "_B", g->func);
+            if(!dup[index]) {
+                // nothing duplicated reaches this gate.
+                pair_map[index].first = node_t::create_gate(g->name, g->func);
+                pair_map[index].second = pair_map[index].first;
+            } else {
+                pair_map[index].first = 
+                    node_t::create_gate(g->name + "_A", g->func);
+                pair_map[index].second = 
+                    node_t::create_gate(g->name + "_B", g->func);
+            }
         }
         // now create the inputs for the gates.
         for(unsigned i=0; i != c.num_gates(); i++) {
@@ -76,6 +97,13 @@ namespace ckt_n {
                 node_t* oA = pair_map[oidx].first;
                 node_t* oB = pair_map[oidx].second;
 
+                // a shared output is the same in both copies. one
+                // comparator is kept anyway, so that final_or has an
+                // input, even if it is constant.
+                if(oA == oB && (final_or->num_inputs() != 0 || i+1 != c.num_outputs())) {
+                    continue;
+                }
+
                 std::string name = oA->name + "_" + oB->name + "_cmp";
                 std::string func = "xor";
                 node_t* g = node_t::create_gate(name, func);
@@ -151,7 +179,58 @@ namespace ckt_n {
             node_t* inpA = pair_map[idx].first;
             node_t* inpB = pair_map[idx].second;
             nA->add_input(inpA);
-            nB->add_input(inpB);
+            if(nB != nA) {
+                nB->add_input(inpB);
+            } else {
+                assert(inpA == inpB);
+            }
+        }
+    }
+
+    // dup[i] is set if node i is duplicated, i.e., if shouldDup is true for
+    // it or one of the nodes in its transitive fanin. this is a depth-first
+    // traversal of the fanins, as in ckt_t::topo_sort, because the gates
+    // needn't be sorted here.
+    void dblckt_t::_init_dup_flags(dup_interface_t& interface, std::vector<bool>& dup)
+    {
+        enum { UNVISITED, ON_STACK, DONE };
+        std::vector<uint8_t> state(ckt.num_nodes(), UNVISITED);
+        dup.assign(ckt.num_nodes(), false);
+
+        for(unsigned i=0; i != ckt.num_inputs(); i++) {
+            node_t* inp = ckt.inputs[i];
+            dup[inp->get_index()] = interface.shouldDup(inp);
+            state[inp->get_index()] = DONE;
+        }
+
+        std::vector< std::pair<node_t*, unsigned> > stack;
+        for(unsigned i=0; i != ckt.num_gates(); i++) {
+            node_t* g = ckt.gates[i];
+            if(state[g->get_index()] != UNVISITED) continue;
+
+            state[g->get_index()] = ON_STACK;
+            stack.push_back(std::make_pair(g, 0u));
+            while(!stack.empty()) {
+                node_t* n = stack.back().first;
+                unsigned j = stack.back().second;
+                if(j < n->num_inputs()) {
+                    stack.back().second += 1;
+                    node_t* nj = n->inputs[j];
+                    assert(state[nj->get_index()] != ON_STACK);
+                    if(state[nj->get_index()] == UNVISITED) {
+                        state[nj->get_index()] = ON_STACK;
+                        stack.push_back(std::make_pair(nj, 0u));
+                    }
+                } else {
+                    bool d = interface.shouldDup(n);
+                    for(unsigned k=0; k != n->num_inputs() && !d; k++) {
+                        d = dup[n->inputs[k]->get_index()];
+                    }
+                    dup[n->get_index()] = d;
+                    state[n->get_index()] = DONE;
+                    stack.pop_back();
+                }
+            }
         }
     }
 
@@ -33,6 +33,24 @@ namespace ckt_n {
         virtual bool shouldDup(node_t* n);
     };
 
+    // all keys and the given nodes, e.g., the ones that are inverted in one
+    // of the copies afterwards. an input in the set isn't duplicated, only
+    // its fanouts are, as invert_gate inverts an input only for the gates
+    // of copy B.
+    struct dup_keysAndNodes_t : public dup_interface_t {
+        nodeset_t nodes;
+        dup_keysAndNodes_t() {}
+        dup_keysAndNodes_t(node_t* n) { nodes.insert(n); }
+        virtual bool shouldDup(node_t* n);
+    };
+
+    // Two copies of a circuit, A and B. The inputs for which shouldDup is
+    // true are duplicated, and so are the gates for which it is true and
+    // the transitive fanout of all of these. The other nodes can't differ
+    // between the copies, so they are shared, i.e., the first and second
+    // node of their pair are the same. With compare_output, the outputs
+    // which are shared aren't compared.
+
     struct dblckt_t
     {
         nodepair_list_t pair_map;
@@ -62,6 +80,7 @@ namespace ckt_n {
         ) const;
     private:
         void _create_inputs(node_t* g);
+        void _init_dup_flags(dup_interface_t& interface, std::vector<bool>& dup);
     };
 }
 #endif
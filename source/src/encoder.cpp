@@ -10,8 +10,8 @@
 
 namespace ckt_n {
 
-    encoder_t::encoder_t(ast_n::statements_t& stms, int seed)
-        : ckt(stms)
+    encoder_t::encoder_t(const bench_file_t& bench, int seed)
+        : ckt(bench)
         , ckt_o(ckt, nm)
         , max_keys(INT_MIN)
     {
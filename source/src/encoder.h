@@ -2,7 +2,7 @@
 #define _ENCODER_H_DEFINED_
 
 #include "ckt.h"
-#include "ast.h"
+#include "benchfile.h"
 #include <list>
 
 namespace ckt_n
@@ -43,7 +43,7 @@ namespace ckt_n
         bool _bad_insertion();
         void _dump_to_file(const std::string& outfile, bool force_dump) const;
 
-        encoder_t(ast_n::statements_t& stms, int seed);
+        encoder_t(const bench_file_t& bench, int seed);
         ~encoder_t();
 
         int encode(int keys, const std::string& outputfile, bool ex);
@@ -0,0 +1,143 @@
+#include "flatckt.h"
+#include "ckt.h"
+
+#include <string.h>
+#include <assert.h>
+
+namespace ckt_n {
+
+    fct flatckt_t::get_fct(const std::string& func)
+    {
+        if(func == "and")       return fct::AND;
+        else if(func == "nand") return fct::NAND;
+        else if(func == "or")   return fct::OR;
+        else if(func == "nor")  return fct::NOR;
+        else if(func == "xor")  return fct::XOR;
+        else if(func == "xnor") return fct::XNOR;
+        else if(func == "not")  return fct::INV;
+        else if(func == "buf")  return fct::BUF;
+        else if(func == "mux")  return fct::MUX;
+        else return fct::UNDEF;
+    }
+
+    void flatckt_t::clear()
+    {
+        functions.clear();
+        flags.clear();
+        levels.clear();
+        fanin_begin.clear();
+        fanins.clear();
+        fanout_begin.clear();
+        fanouts.clear();
+        name_begin.clear();
+        names.clear();
+        order.clear();
+        gate_order.clear();
+        ckt_inputs.clear();
+        key_inputs.clear();
+        outputs.clear();
+    }
+
+    void flatckt_t::build(const ckt_t& ckt)
+    {
+        assert(ckt.nodes_sorted.size() == ckt.nodes.size());
+        clear();
+
+        unsigned n = ckt.num_nodes();
+        functions.resize(n, fct::UNDEF);
+        flags.resize(n, 0);
+        levels.resize(n, 0);
+        fanin_begin.resize(n+1, 0);
+        fanout_begin.resize(n+1, 0);
+        name_begin.resize(n+1, 0);
+
+        // first pass: the per-node arrays and the CSR offsets.
+        unsigned num_fanins = 0, num_fanouts = 0, num_chars = 0;
+        for(unsigned i=0; i != n; i++) {
+            const node_t* nd = ckt.nodes[i];
+            assert(nd->get_index() == (int) i);
+
+            if(nd->is_input()) {
+                flags[i] |= nd->is_keyinput() ? (INPUT | KEYINPUT) : INPUT;
+            } else {
+                flags[i] |= GATE;
+                functions[i] = get_fct(nd->func);
+            }
+            if(nd->output) {
+                flags[i] |= OUTPUT;
+            }
+            levels[i] = nd->level;
+
+            fanin_begin[i] = num_fanins;
+            num_fanins += nd->num_inputs();
+            fanout_begin[i] = num_fanouts;
+            num_fanouts += nd->num_fanouts();
+            name_begin[i] = num_chars;
+            num_chars += nd->name.size() + 1;
+        }
+        fanin_begin[n] = num_fanins;
+        fanout_begin[n] = num_fanouts;
+        name_begin[n] = num_chars;
+
+        // second pass: fill the CSR arrays.
+        fanins.resize(num_fanins);
+        fanouts.resize(num_fanouts);
+        names.resize(num_chars);
+        for(unsigned i=0; i != n; i++) {
+            const node_t* nd = ckt.nodes[i];
+            unsigned* fi = &fanins[0] + fanin_begin[i];
+            for(unsigned j=0; j != nd->num_inputs(); j++) {
+                fi[j] = nd->inputs[j]->get_index();
+            }
+            unsigned* fo = &fanouts[0] + fanout_begin[i];
+            for(unsigned j=0; j != nd->num_fanouts(); j++) {
+                fo[j] = nd->fanouts[j]->get_index();
+            }
+            memcpy(&names[name_begin[i]], nd->name.c_str(), nd->name.size() + 1);
+        }
+
+        order.resize(n);
+        for(unsigned i=0; i != n; i++) {
+            order[i] = ckt.nodes_sorted[i]->get_index();
+        }
+        gate_order.resize(ckt.gates_sorted.size());
+        for(unsigned i=0; i != gate_order.size(); i++) {
+            gate_order[i] = ckt.gates_sorted[i]->get_index();
+        }
+
+        ckt_inputs.resize(ckt.num_ckt_inputs());
+        for(unsigned i=0; i != ckt_inputs.size(); i++) {
+            ckt_inputs[i] = ckt.ckt_inputs[i]->get_index();
+        }
+        key_inputs.resize(ckt.num_key_inputs());
+        for(unsigned i=0; i != key_inputs.size(); i++) {
+            key_inputs[i] = ckt.key_inputs[i]->get_index();
+        }
+        outputs.resize(ckt.num_outputs());
+        for(unsigned i=0; i != outputs.size(); i++) {
+            outputs[i] = ckt.outputs[i]->get_index();
+        }
+    }
+
+    void flatckt_t::compute_transitive_fanin(unsigned root, std::vector<bool>& fanin_flags, bool reset) const
+    {
+        assert(root < num_nodes());
+        if(reset) { std::fill(fanin_flags.begin(), fanin_flags.end(), false); }
+        if(fanin_flags[root]) return;
+
+        std::vector<unsigned> stack;
+        stack.push_back(root);
+        fanin_flags[root] = true;
+        while(!stack.empty()) {
+            unsigned i = stack.back();
+            stack.pop_back();
+            const unsigned* fi = fanins_of(i);
+            for(unsigned j=0, m=num_fanins(i); j != m; j++) {
+                if(!fanin_flags[fi[j]]) {
+                    fanin_flags[fi[j]] = true;
+                    stack.push_back(fi[j]);
+                }
+            }
+        }
+    }
+}
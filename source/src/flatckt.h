@@ -0,0 +1,71 @@
+#ifndef _FLATCKT_H_DEFINED_
+#define _FLATCKT_H_DEFINED_
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include "node.h"
+
+namespace ckt_n {
+    struct ckt_t;
+
+    // Compact, index-based copy of the structure of a circuit.
+    //
+    // Nodes are identified by their index (node_t::index); the gate
+    // functions and flags are kept in arrays indexed by node, and the
+    // fan-ins and fan-outs in CSR form, i.e., the fan-ins of node i are
+    // fanins[fanin_begin[i]] ... fanins[fanin_begin[i+1]-1]. The names are
+    // interned into a single character array. Traversals over this form
+    // touch a few contiguous arrays instead of chasing node_t pointers.
+    //
+    // The copy is made by ckt_t::topo_sort, so just like gates_sorted and
+    // nodes_sorted it is out of date after the circuit is modified, until
+    // topo_sort is called again. The stochastic attributes of the gates
+    // (error rates, polymorphic functions) are not copied.
+    struct flatckt_t {
+        enum { INPUT = 1, KEYINPUT = 2, GATE = 4, OUTPUT = 8 };
+
+        std::vector<fct>        functions;
+        std::vector<uint8_t>    flags;
+        std::vector<unsigned>   levels;
+        std::vector<unsigned>   fanin_begin;
+        std::vector<unsigned>   fanins;
+        std::vector<unsigned>   fanout_begin;
+        std::vector<unsigned>   fanouts;
+        std::vector<unsigned>   name_begin;
+        std::vector<char>       names;
+
+        // all nodes, and the gates only, in level order.
+        std::vector<unsigned>   order;
+        std::vector<unsigned>   gate_order;
+
+        std::vector<unsigned>   ckt_inputs;
+        std::vector<unsigned>   key_inputs;
+        std::vector<unsigned>   outputs;
+
+        void build(const ckt_t& ckt);
+        void clear();
+
+        unsigned num_nodes() const { return functions.size(); }
+        unsigned num_gates() const { return gate_order.size(); }
+
+        bool is_input(unsigned i) const { return flags[i] & INPUT; }
+        bool is_keyinput(unsigned i) const { return flags[i] & KEYINPUT; }
+        bool is_gate(unsigned i) const { return flags[i] & GATE; }
+        bool is_output(unsigned i) const { return flags[i] & OUTPUT; }
+
+        unsigned num_fanins(unsigned i) const { return fanin_begin[i+1] - fanin_begin[i]; }
+        const unsigned* fanins_of(unsigned i) const { return &fanins[0] + fanin_begin[i]; }
+        unsigned num_fanouts(unsigned i) const { return fanout_begin[i+1] - fanout_begin[i]; }
+        const unsigned* fanouts_of(unsigned i) const { return &fanouts[0] + fanout_begin[i]; }
+        const char* name(unsigned i) const { return &names[name_begin[i]]; }
+
+        // mark the transitive fanin of node root. nodes which are already
+        // marked are not expanded, so they act as cut points.
+        void compute_transitive_fanin(unsigned root, std::vector<bool>& fanin_flags, bool reset=true) const;
+
+        static fct get_fct(const std::string& func);
+    };
+}
+
+#endif
@@ -14,8 +14,9 @@ int lcheck_main(int argc, char* argv[])
     using namespace AllSAT;
 
     std::string graph_out_file;
+    bool parallel = false;
     int c;
-    while ((c = getopt (argc, argv, "ho:")) != -1) {
+    while ((c = getopt (argc, argv, "hpo:")) != -1) {
         switch (c) {
             case 'h':
                 print_lcheck_usage(argv[0]);
@@ -24,6 +25,9 @@ int lcheck_main(int argc, char* argv[])
             case 'o':
                 graph_out_file = optarg;
                 break;
+            case 'p':
+                parallel = true;
+                break;
             default:
                 std::cerr << "Unknown option: '" << c << "'" << std::endl;
                 print_lcheck_usage(argv[0]);
@@ -36,15 +40,9 @@ int lcheck_main(int argc, char* argv[])
         return 1;
     }
 
-    yyin = fopen(argv[optind], "rt");
-    if(yyin == NULL) {
-        perror(argv[optind]);
-        return 1;
-    }
-
-    if(yyparse() == 0) {
-        using namespace ast_n;
-        ckt_n::ckt_t ckt(*statements);
+    ckt_n::bench_file_t bench;
+    if(bench.read(argv[optind])) {
+        ckt_n::ckt_t ckt(bench);
 
         ckt_eval_t sim(ckt, ckt.ckt_inputs);
 
@@ -54,16 +52,18 @@ int lcheck_main(int argc, char* argv[])
         std::cout << "solveSingleKeys found " << keysFound.size() << " keys." << std::endl;
 
         int cnt = -1;
+        std::ofstream fout;
         if(graph_out_file.size()) {
-            std::ofstream fout(graph_out_file.c_str());
-            if(fout) {
-                cnt = tvs.countNonMutablePairs(fout);
-            } else {
+            fout.open(graph_out_file.c_str());
+            if(!fout) {
                 std::cerr << "Error writing file: " << graph_out_file << std::endl;
-                cnt = tvs.countNonMutablePairs(std::cout);
             }
+        }
+        std::ostream& out = fout.is_open() ? (std::ostream&) fout : std::cout;
+        if(parallel) {
+            cnt = tvs.countNonMutablePairsParallel(out);
         } else {
-            cnt = tvs.countNonMutablePairs(std::cout);
+            cnt = tvs.countNonMutablePairs(out);
         }
         std::cout << "# of keys=" << ckt.num_key_inputs() << std::endl;
         std::cout << "# of non-mutable pairs=" << cnt << std::endl;
@@ -78,7 +78,8 @@ int lcheck_main(int argc, char* argv[])
 void print_lcheck_usage(const char* argv0)
 {
     std::cerr << "Syntax error. Usage: " << std::endl;
-    std::cerr << "    " << argv0 << " [-o non-mutability-graph-file] <bench>" << std::endl;
+    std::cerr << "    " << argv0 << " [-p] [-o non-mutability-graph-file] <bench>" << std::endl;
+    std::cerr << "    -p : check the key pairs in parallel, with one incremental solver per key." << std::endl;
 }
 
 
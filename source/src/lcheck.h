@@ -3,8 +3,6 @@
 
 #include <stdio.h>
 
-extern int yyparse();
-extern FILE* yyin;
 
 int lcheck_main(int argc, char* argv[]);
 void print_lcheck_usage(const char* argv0);
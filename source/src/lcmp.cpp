@@ -1,6 +1,5 @@
 #include "lcmp.h"
 #include <iostream>
-#include "ast.h"
 #include "ckt.h"
 #include "sld.h"
 
@@ -14,19 +13,13 @@ int lcmp_main(int argc, char* argv[])
     }
     
     // read original circuit
-    yyin = NULL;
-    yyin = fopen(argv[2], "rt");
-    if(yyin == NULL) {
-        perror(argv[2]);
-        return 1;
-    }
-    if(yyparse() != 0) {
+    ckt_n::bench_file_t bench1;
+    if(!bench1.read(argv[2])) {
         std::cerr << "Syntax error in " << argv[2] << std::endl;
         return 1;
     }
-    ckt_n::ckt_t ckt1(*ast_n::statements);
-    delete ast_n::statements;
-    fclose(yyin);
+    ckt_n::ckt_t ckt1(bench1);
+    bench1.close();
 
     if(ckt1.num_key_inputs() > 0) {
         std::cerr << "Error. The original circuit must not have key inputs." << std::endl;
@@ -35,19 +28,13 @@ int lcmp_main(int argc, char* argv[])
 
 
     // read encrypted circuit
-    yyin = NULL;
-    yyin = fopen(argv[1], "rt");
-    if(yyin == NULL) {
-        perror(argv[1]);
-        return 1;
-    }
-    if(yyparse() != 0) {
+    ckt_n::bench_file_t bench2;
+    if(!bench2.read(argv[1])) {
         std::cerr << "Syntax error in " << argv[1] << std::endl;
         return 1;
     }
-    ckt_n::ckt_t ckt2(*ast_n::statements);
-    delete ast_n::statements;
-    fclose(yyin);
+    ckt_n::ckt_t ckt2(bench2);
+    bench2.close();
 
 
     if(strstr(argv[3], "key=") != argv[3]) {
@@ -70,15 +70,10 @@ int lle_main(int argc, char* argv[])
 
     std::cout << "file to encrypt: " << argv[optind] << std::endl;
 
-    yyin = fopen(argv[optind], "rt");
-    if(yyin == NULL) {
-        perror(argv[optind]);
-        return 1;
-    }
 
-    if(yyparse() == 0) {
-        using namespace ast_n;
-        ckt_n::lut_encoder_t enc(*statements, 49371031 /* picked something for a seed. */);
+    ckt_n::bench_file_t bench;
+    if(bench.read(argv[optind])) {
+        ckt_n::lut_encoder_t enc(bench, 49371031 /* picked something for a seed. */);
         int num_keys = target_keys == -1 ? (int) (ceil(enc.ckt.num_gates() * 0.2 )) : target_keys;
         std::cout << "target keys=" << num_keys << std::endl;
         std::cout << "keys added=" << enc.encode(num_keys, output_file, extended) << std::endl;
@@ -3,8 +3,8 @@
 
 namespace ckt_n
 {
-    lut_encoder_t::lut_encoder_t(ast_n::statements_t& stms, int seed)
-        : ckt(stms)
+    lut_encoder_t::lut_encoder_t(const bench_file_t& bench, int seed)
+        : ckt(bench)
     {
         srand(seed);
     }
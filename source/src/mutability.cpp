@@ -1,8 +1,6 @@
 #include "mutability.h"
 #include "dbl.h"
-#include "forker.h"
-#include <sys/types.h>
-#include <sys/wait.h>
+#include <algorithm>
 
 namespace ckt_n {
 
@@ -18,81 +16,89 @@ namespace ckt_n {
         // the output map keeps track of the number of outputs affected by each node.
         std::vector< std::vector<bool> > output_maps;
         ckt.init_outputmap(output_maps);
-        unsigned num_nodes = ckt.num_nodes();
-        static const unsigned STEP_SIZE = 8;
+        int num_nodes = ckt.num_nodes();
         std::cout << "num_nodes = " << num_nodes << std::endl;
 
-        uint8_t *computed_flags = new uint8_t[num_nodes];
-        uint8_t *observable_flags = new uint8_t[num_nodes];
-
-        for(unsigned gstart=0; gstart < num_nodes; gstart += STEP_SIZE) {
-
-            forker_t f;
-            pid_t childpid = f.fork();
-            if(childpid == -1) {
-                std::cout << "Error forking!" << std::endl;
-                exit(1);
-            } else if(childpid == 0) {
-                // child.
-                unsigned istart = gstart;
-                unsigned icount = std::min(STEP_SIZE, num_nodes-istart);
-
-                std::cout << "range: " << istart << ":" << istart+icount 
-                          << std::endl;
-                #pragma omp parallel for
-                for(unsigned i=0; i < icount; i++) {
-                    unsigned iadjusted = i + istart; 
-                    node_t* ni = ckt.nodes[iadjusted];
-                    if(is_observable(ni, output_maps[ni->get_index()])) {
-                        analyze(ni, output_maps);
-                    }
+        // the nodes are handed out one at a time since the cost of a node
+        // varies a lot. each thread only holds the slice and the solver of
+        // the pair it is working on, on top of its workspace.
+        const unsigned report = std::max(num_nodes / 100, 1);
+        processed = 0;
+        #pragma omp parallel
+        {
+            workspace_t ws;
+            #pragma omp for schedule(dynamic, 1)
+            for(int i=0; i < num_nodes; i++) {
+                node_t* ni = ckt.nodes[i];
+                if(is_observable(ni, output_maps[ni->get_index()])) {
+                    analyze(ni, output_maps, ws);
                 }
 
-                // send updated observability cache to parent.
-                assert(observable_computed.size() == num_nodes);
-                assert(observable_value.size() == num_nodes);
-                for(unsigned i=0; i != num_nodes; i++) {
-                    computed_flags[i] = (uint8_t) observable_computed[i];
-                    observable_flags[i] = (uint8_t) observable_value[i];
-                }
-                f.write(computed_flags, num_nodes);
-                f.write(observable_flags, num_nodes);
-                f.close();
-                exit(0);
-            } else {
-                // parent.
-                int status;
-                waitpid(childpid, &status, 0);
-                if(status != 0) {
-                    std::cout << "Child process error." << std::endl;
-                    exit(1);
+                unsigned done = ++processed;
+                if(done % report == 0 || done == (unsigned) num_nodes) {
+                    #pragma omp critical(mutability_progress)
+                    std::cout << "progress: " << done << "/" << num_nodes << std::endl;
                 }
+            }
+        }
+        std::cout << "immutability checks: " << num_checks
+                  << "; refuted by simulation: " << num_refuted
+                  << "; SAT calls: " << (num_checks - num_refuted) << std::endl;
+    }
 
-                // update the observability cache.
-                f.read(computed_flags, num_nodes);
-                f.read(observable_flags, num_nodes);
+    bool mutability_analysis_t::is_refuted_by_simulation(node_t* n1, node_t* n2, workspace_t& ws)
+    {
+        typedef bitsim_t::word_t word_t;
 
-                assert(observable_computed.size() == num_nodes);
-                assert(observable_value.size() == num_nodes);
-                for(unsigned i=0; i != num_nodes; i++) {
-                    observable_computed[i] = computed_flags[i];
-                    observable_value[i] = observable_flags[i];
+        if(ws.valA.values.empty()) {
+            bsim.init_frame(ws.valA, bitsim_t::DEFAULT_WORDS);
+            bsim.init_frame(ws.knownA, bitsim_t::DEFAULT_WORDS);
+            bsim.init_frame(ws.valB, bitsim_t::DEFAULT_WORDS);
+            bsim.init_frame(ws.knownB, bitsim_t::DEFAULT_WORDS);
+        }
+        const unsigned words = ws.valA.words;
+        const int i1 = n1->get_index(), i2 = n2->get_index();
+
+        // the same vectors for a pair no matter which thread checks it.
+        rng_t rng(((uint64_t) i1 << 32) | (uint64_t) i2);
+        for(unsigned r=0; r != SIM_ROUNDS; r++) {
+            for(unsigned i=0; i != ckt.num_ckt_inputs(); i++) {
+                unsigned idx = ckt.ckt_inputs[i]->get_index();
+                for(unsigned w=0; w != words; w++) {
+                    ws.valA.values[idx * words + w] = rng.next();
+                    ws.knownA.values[idx * words + w] = ~(word_t)0;
+                }
+            }
+            ws.valB.values = ws.valA.values;
+            ws.knownB.values = ws.knownA.values;
+
+            bsim.eval_ternary(ws.valA, ws.knownA, i2, -1);
+            bsim.eval_ternary(ws.valB, ws.knownB, i2, i1);
+
+            for(unsigned o=0; o != ckt.num_outputs(); o++) {
+                node_t* out = ckt.outputs[o];
+                // the doubled circuit shares inputs, so an inverted input
+                // which is also an output isn't compared.
+                if(out == n1 && n1->is_input()) continue;
+
+                unsigned idx = out->get_index();
+                for(unsigned w=0; w != words; w++) {
+                    word_t k = ws.knownA.values[idx * words + w] & ws.knownB.values[idx * words + w];
+                    if(k & (ws.valA.values[idx * words + w] ^ ws.valB.values[idx * words + w])) {
+                        return true;
+                    }
                 }
             }
         }
-        delete [] computed_flags;
-        delete [] observable_flags;
+        return false;
     }
 
     bool mutability_analysis_t::is_observable(node_t* n, std::vector<bool>& output_map) 
     {
-        pthread_mutex_lock(&obsmutex);
-        if(observable_computed[n->get_index()]) {
-            bool result =  observable_value[n->get_index()];
-            pthread_mutex_unlock(&obsmutex);
-            return result;
+        uint8_t cached = observability[n->get_index()].load(std::memory_order_acquire);
+        if(cached != OBS_UNKNOWN) {
+            return cached == OBS_TRUE;
         }
-        pthread_mutex_unlock(&obsmutex);
 
         assert(ckt.num_key_inputs() == 0);
         bool result;
@@ -101,8 +107,6 @@ namespace ckt_n {
         if(n->is_input() && n->output) {
             result = true;
         } else {
-            int index = n->get_index();
-            pthread_mutex_lock(&obsmutexes[index]);
             nodelist_t outputs;
             for(unsigned i=0; i != ckt.num_outputs(); i++) {
                 if(output_map[i]) {
@@ -124,8 +128,10 @@ namespace ckt_n {
                 assert(pos_n != nm_fwd.end());
                 node_t* n_pr  = pos_n->second;
 
-                // now we want to double this circuit.
-                dblckt_t dbl(cs, dup_allkeys, true);
+                // now we want to double this circuit. n_pr is inverted in
+                // one copy, so it mustn't be shared.
+                dup_keysAndNodes_t dup(n_pr);
+                dblckt_t dbl(cs, dup, true);
                 // n_p2 is the node we are going to invert in the doubled ckt.
                 node_t* n_p2 = dbl.getB(n_pr);
 
@@ -150,26 +156,23 @@ namespace ckt_n {
 
                 result = S.solve(l);
             }
-            pthread_mutex_unlock(&obsmutexes[index]);
         }
 
-        pthread_mutex_lock(&obsmutex);
-        observable_computed[n->get_index()] = true;
-        observable_value[n->get_index()] = result;
-        pthread_mutex_unlock(&obsmutex);
+        observability[n->get_index()].store(result ? OBS_TRUE : OBS_FALSE, std::memory_order_release);
 
         return result;
     }
 
-    void mutability_analysis_t::analyze(node_t* n, std::vector< std::vector<bool> >& output_map)
+    void mutability_analysis_t::analyze(node_t* n, std::vector< std::vector<bool> >& output_map, workspace_t& ws)
     {
         const std::vector<bool>& om = output_map[n->get_index()];
         assert(om.size() == ckt.num_outputs());
 
-        std::vector<bool> output_fanins(ckt.num_nodes(), false);
+        std::vector<bool>& output_fanins = ws.output_fanins;
+        output_fanins.assign(ckt.num_nodes(), false);
         for(unsigned i=0; i != om.size(); i++) {
             if(om[i]) {
-                ckt.compute_transitive_fanin(ckt.outputs[i], output_fanins, false /* no reset. */);
+                ckt.flat.compute_transitive_fanin(ckt.flat.outputs[i], output_fanins, false /* no reset. */);
             }
         }
         for(int i=0; i != (int)output_fanins.size(); i++) {
@@ -179,14 +182,13 @@ namespace ckt_n {
                     if(is_observable(ni, output_map[ni->get_index()])) {
                         assert(ni->get_index() == i);
                                   // is there a test vector with ni=X that distinguishes n=0|1
-                        int cnt = is_immutable(n, ni, output_map)*2 +
+                        int cnt = is_immutable(n, ni, output_map, ws)*2 +
                                   // is there a test vector with n=X that distinguishes ni=0|1
-                                  is_immutable(ni, n, output_map);
+                                  is_immutable(ni, n, output_map, ws);
                         if(cnt) {
-                            pthread_mutex_lock(&outmutex);
+                            #pragma omp critical(mutability_out)
                             out << n->name << " " << ni->name << " " 
                                 << cnt << std::endl;
-                            pthread_mutex_unlock(&outmutex);
                         }
                     }
                 }
@@ -196,26 +198,35 @@ namespace ckt_n {
 
     bool mutability_analysis_t::is_immutable(
         node_t* n1, node_t* n2, 
-        std::vector< std::vector<bool> >& output_map
+        std::vector< std::vector<bool> >& output_map,
+        workspace_t& ws
     )
     {
+        num_checks++;
+        if(is_refuted_by_simulation(n1, n2, ws)) {
+            num_refuted++;
+            return false;
+        }
+
         // get the outputs affected by these two nodes.
         std::vector<bool>& om1 = output_map[n1->get_index()];
         std::vector<bool>& om2 = output_map[n2->get_index()];
 
         // the fanin_flags encode the nodes in the circuit which are necessary
         // to compute the outputs required by both n1 and n2.
-        std::vector<bool> fanin_flags(ckt.num_nodes(), false);
+        std::vector<bool>& fanin_flags = ws.fanin_flags;
+        fanin_flags.assign(ckt.num_nodes(), false);
         fanin_flags[n2->get_index()] = true;
 
         // walk through the outputs and do the recursive traversal.
-        std::vector<bool> om(om1.size());
+        std::vector<bool>& om = ws.om;
+        om.resize(om1.size());
         assert(om.size() == om2.size());
         assert(om2.size() == ckt.num_outputs());
         for(unsigned i=0; i != om.size(); i++) {
             om[i] = om1[i] || om2[i];
             if(om[i]) {
-                ckt.compute_transitive_fanin(ckt.outputs[i], fanin_flags, false/*noreset*/);
+                ckt.flat.compute_transitive_fanin(ckt.flat.outputs[i], fanin_flags, false/*noreset*/);
             }
         }
 
@@ -252,8 +263,10 @@ namespace ckt_n {
         assert(pos_n2 != nm_fwd.end());
         node_t* n_pr2  = pos_n2->second;
 
-        // now we again double this circuit.
-        dblckt_t dbl(cs, dup_allkeys, true);
+        // now we again double this circuit, without sharing the two nodes.
+        dup_keysAndNodes_t dup(n_pr1);
+        dup.nodes.insert(n_pr2);
+        dblckt_t dbl(cs, dup, true);
 
         // n_p1 is the node we are going to invert in the doubled ckt.
         node_t* n_p1 = dbl.getB(n_pr1);
@@ -2,8 +2,9 @@
 #define _MUTABILITY_H_DEFINED_
 
 #include "ckt.h"
+#include "bitsim.h"
 #include <set>
-#include <pthread.h>
+#include <atomic>
 
 // TODO:
 // 1. build observability cache.
@@ -15,47 +16,62 @@ namespace ckt_n {
     {
     public:
         typedef std::pair<node_t*, node_t*> node_pair_t;
+
+        // per-thread scratch space, reused for all the nodes processed
+        // by the thread.
+        struct workspace_t {
+            std::vector<bool> output_fanins;
+            std::vector<bool> fanin_flags;
+            std::vector<bool> om;
+            // fault-free and faulty circuit for the simulation pre-filter.
+            bitsim_t::frame_t valA, knownA, valB, knownB;
+        };
     protected:
+        // observability cache: OBS_UNKNOWN until computed. two threads may
+        // compute the same node concurrently, they store the same value.
+        enum { OBS_UNKNOWN = 0, OBS_FALSE = 1, OBS_TRUE = 2 };
+
         ckt_t& ckt;
         std::set<node_pair_t> immutables;
-        std::vector<bool> observable_value;
-        std::vector<bool> observable_computed;
-        pthread_mutex_t outmutex;
-        pthread_mutex_t obsmutex;
-        pthread_mutex_t* obsmutexes;
+        std::atomic<uint8_t>* observability;
+        std::atomic<unsigned> processed;
         std::ostream& out;
+
+        // random vectors tried per pair before falling back to SAT.
+        static const unsigned SIM_ROUNDS = 1;
+        bitsim_t bsim;
+        std::atomic<uint64_t> num_checks;
+        std::atomic<uint64_t> num_refuted;
     public:
         mutability_analysis_t(ckt_t& c, std::ostream& sout) 
             : ckt(c)
+            , processed(0)
             , out(sout)
+            , bsim(c)
+            , num_checks(0)
+            , num_refuted(0)
         {
             assert(ckt.num_key_inputs() == 0);
-            observable_value.resize(ckt.num_nodes(), false);
-            observable_computed.resize(ckt.num_nodes(), false);
-            pthread_mutex_init(&outmutex, NULL);
-            pthread_mutex_init(&obsmutex, NULL);
-
-            obsmutexes = new pthread_mutex_t[ckt.num_nodes()];
+            observability = new std::atomic<uint8_t>[ckt.num_nodes()];
             for(unsigned i=0; i != ckt.num_nodes(); i++) {
-                pthread_mutex_init(&obsmutexes[i], NULL);
+                observability[i].store(OBS_UNKNOWN, std::memory_order_relaxed);
             }
         }
 
         ~mutability_analysis_t() {
-            pthread_mutex_destroy(&outmutex);
-            pthread_mutex_destroy(&obsmutex);
-            for(unsigned i=0; i != ckt.num_nodes(); i++) {
-                pthread_mutex_destroy(&obsmutexes[i]);
-            }
+            delete [] observability;
         }
 
         void add_immutable(node_t* n1, node_t* n2);
         void analyze();
 
         bool is_observable(node_t* n, std::vector<bool>& output_map);
-        void analyze(node_t *n, std::vector< std::vector<bool> >& output_map);
+        void analyze(node_t *n, std::vector< std::vector<bool> >& output_map, workspace_t& ws);
         bool is_immutable( node_t* n1, node_t* n2, 
-            std::vector< std::vector<bool> >& output_map);
+            std::vector< std::vector<bool> >& output_map, workspace_t& ws);
+        // true if a random vector distinguishes n1=0|1 with n2=X, which
+        // means n1,n2 is not immutable.
+        bool is_refuted_by_simulation(node_t* n1, node_t* n2, workspace_t& ws);
     };
 
 }
@@ -19,7 +19,7 @@ namespace ckt_n {
     typedef std::set<node_t*> nodeset_t;
 
 	// JOHANN
-	enum class fct : unsigned {UNDEF, AND, NAND, OR, NOR, XOR, XNOR, INV, BUF};
+	enum class fct : unsigned {UNDEF, AND, NAND, OR, NOR, XOR, XNOR, INV, BUF, MUX};
 
 	struct poly_fct {
 		fct function;
@@ -123,6 +123,13 @@ namespace ckt_n {
         }
     }
 
+    inline sat_n::Var node_var(const index2var_map_t& map, const node_t* n)
+    {
+        assert(n->index >= 0 && n->index < (int) map.size());
+        assert(map[n->index] >= 0);
+        return map[n->index];
+    }
+
     std::ostream& operator<<(std::ostream& out, const node_t& n);
     std::ostream& operator<<(std::ostream& out, const nodelist_t& nl);
     std::ostream& operator<<(std::ostream& out, const nodeset_t& nout);
@@ -8,8 +8,8 @@ ILOSTLBEGIN
 
 namespace ckt_n {
 
-    ilp_encoder_t::ilp_encoder_t(ast_n::statements_t& stms, double fraction)
-        : ckt(stms)
+    ilp_encoder_t::ilp_encoder_t(const bench_file_t& bench, double fraction)
+        : ckt(bench)
     {
         target_keys = int(ckt.num_gates() * fraction + 0.5);
     }
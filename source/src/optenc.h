@@ -2,7 +2,7 @@
 #define _OPT_ENC_H_DEFINED_H_
 
 #include <iostream>
-#include "ast.h"
+#include "benchfile.h"
 #include "ckt.h"
 #include "SATInterface.h"
 
@@ -16,7 +16,7 @@ namespace ckt_n {
         int get_min_output_level(node_t* n, std::vector<bool>& output_map);
         int should_use_min_cnst(node_t* n, std::vector<bool>& output_map);
     public:
-        ilp_encoder_t(ast_n::statements_t& stms, double fraction);
+        ilp_encoder_t(const bench_file_t& bench, double fraction);
         virtual ~ilp_encoder_t();
         
         void encode1();
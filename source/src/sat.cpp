@@ -1,3 +1,4 @@
+#include "node.h"
 #include "sat.h"
 
 namespace ckt_n {
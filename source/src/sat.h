@@ -11,14 +11,18 @@
 namespace ckt_n {
     struct node_t;
     typedef std::vector<node_t*> nodelist_t;
-    typedef std::map<node_t*, sat_n::Var> node2var_map_t;
     typedef std::vector<sat_n::Lit> index2lit_map_t;
+    // variables of the nodes, indexed by node_t::index; -1 if unassigned.
+    typedef std::vector<sat_n::Var> index2var_map_t;
+
+    // the variable of node n; defined in node.h.
+    inline sat_n::Var node_var(const index2var_map_t& map, const node_t* n);
 
     template<class Solver>
     struct clause_provider_i {
         virtual void add_clauses(
             Solver& S, 
-            node2var_map_t& map, 
+            const index2var_map_t& map, 
             nodelist_t& inputs, 
             node_t* output
         ) const = 0;
@@ -35,21 +39,19 @@ namespace ckt_n {
     struct and_provider_t : public clause_provider_i<Solver> {
         virtual void add_clauses(
             Solver& S, 
-            node2var_map_t& map, 
+            const index2var_map_t& map, 
             nodelist_t& inputs, 
             node_t* output
         ) const
         {
             using namespace sat_n;
 
-            assert(map.find(output) != map.end());
-            Lit y = mkLit(map[output]);
+            Lit y = mkLit(node_var(map, output));
 
             vec_lit_t xs;
             xs.growTo(inputs.size() + 1);
             for(unsigned i=0; i != inputs.size(); i++) {
-                assert(map.find(inputs[i]) != map.end());
-                xs[i] = mkLit(map[inputs[i]]);
+                xs[i] = mkLit(node_var(map, inputs[i]));
 
                 // ~xs[i] => ~y
                 // <==> xs[i] + ~y 
@@ -67,21 +69,19 @@ namespace ckt_n {
     struct or_provider_t : public clause_provider_i<Solver> {
         virtual void add_clauses(
             Solver& S, 
-            node2var_map_t& map, 
+            const index2var_map_t& map, 
             nodelist_t& inputs, 
             node_t* output
         ) const
         {
             using namespace sat_n;
 
-            assert(map.find(output) != map.end());
-            Lit y = mkLit(map[output]);
+            Lit y = mkLit(node_var(map, output));
 
             vec_lit_t xs;
             xs.growTo(inputs.size() + 1);
             for(unsigned i=0; i != inputs.size(); i++) {
-                assert(map.find(inputs[i]) != map.end());
-                xs[i] = mkLit(map[inputs[i]]);
+                xs[i] = mkLit(node_var(map, inputs[i]));
 
                 // xs[i] => y
                 // <==> ~xs[i] + y 
@@ -98,21 +98,19 @@ namespace ckt_n {
     struct nand_provider_t : public clause_provider_i<Solver> {
         virtual void add_clauses(
             Solver& S, 
-            node2var_map_t& map, 
+            const index2var_map_t& map, 
             nodelist_t& inputs, 
             node_t* output
         ) const
         {
             using namespace sat_n;
 
-            assert(map.find(output) != map.end());
-            Lit y = mkLit(map[output]);
+            Lit y = mkLit(node_var(map, output));
 
             vec_lit_t xs;
             xs.growTo(inputs.size() + 1);
             for(unsigned i=0; i != inputs.size(); i++) {
-                assert(map.find(inputs[i]) != map.end());
-                xs[i] = mkLit(map[inputs[i]]);
+                xs[i] = mkLit(node_var(map, inputs[i]));
 
                 // ~xs[i] => y
                 // <==> xs[i] + y 
@@ -130,21 +128,19 @@ namespace ckt_n {
     struct nor_provider_t : public clause_provider_i<Solver> {
         virtual void add_clauses(
             Solver& S, 
-            node2var_map_t& map, 
+            const index2var_map_t& map, 
             nodelist_t& inputs, 
             node_t* output
         ) const
         {
             using namespace sat_n;
 
-            assert(map.find(output) != map.end());
-            Lit y = mkLit(map[output]);
+            Lit y = mkLit(node_var(map, output));
 
             vec_lit_t xs;
             xs.growTo(inputs.size() + 1);
             for(unsigned i=0; i != inputs.size(); i++) {
-                assert(map.find(inputs[i]) != map.end());
-                xs[i] = mkLit(map[inputs[i]]);
+                xs[i] = mkLit(node_var(map, inputs[i]));
 
                 // xs[i] => ~y
                 // <==> ~xs[i] + ~y 
@@ -161,7 +157,7 @@ namespace ckt_n {
     struct xor_provider_t : public clause_provider_i<Solver> {
         virtual void add_clauses(
             Solver& S, 
-            node2var_map_t& map, 
+            const index2var_map_t& map, 
             nodelist_t& inputs, 
             node_t* output
         ) const
@@ -169,13 +165,10 @@ namespace ckt_n {
             using namespace sat_n;
 
             assert(inputs.size() == 2);
-            assert(map.find(inputs[0]) != map.end());
-            assert(map.find(inputs[1]) != map.end());
-            Lit a = mkLit(map[inputs[0]]);
-            Lit b = mkLit(map[inputs[1]]);
+            Lit a = mkLit(node_var(map, inputs[0]));
+            Lit b = mkLit(node_var(map, inputs[1]));
 
-            assert(map.find(output) != map.end());
-            Lit y = mkLit(map[output]);
+            Lit y = mkLit(node_var(map, output));
 
             // ~a ~b => ~y <==> a + b + ~y
             S.addClause(a, b, ~y);
@@ -192,7 +185,7 @@ namespace ckt_n {
     struct xnor_provider_t : public clause_provider_i<Solver> {
         virtual void add_clauses(
             Solver& S, 
-            node2var_map_t& map, 
+            const index2var_map_t& map, 
             nodelist_t& inputs, 
             node_t* output
         ) const
@@ -200,13 +193,10 @@ namespace ckt_n {
             using namespace sat_n;
 
             assert(inputs.size() == 2);
-            assert(map.find(inputs[0]) != map.end());
-            assert(map.find(inputs[1]) != map.end());
-            Lit a = mkLit(map[inputs[0]]);
-            Lit b = mkLit(map[inputs[1]]);
+            Lit a = mkLit(node_var(map, inputs[0]));
+            Lit b = mkLit(node_var(map, inputs[1]));
 
-            assert(map.find(output) != map.end());
-            Lit y = mkLit(map[output]);
+            Lit y = mkLit(node_var(map, output));
 
             // ~a ~b => y <==> a + b + y
             S.addClause(a, b, y);
@@ -223,7 +213,7 @@ namespace ckt_n {
     struct mux_provider_t : public clause_provider_i<Solver> {
         virtual void add_clauses(
             Solver& S, 
-            node2var_map_t& map, 
+            const index2var_map_t& map, 
             nodelist_t& inputs, 
             node_t* output
         ) const
@@ -237,15 +227,11 @@ namespace ckt_n {
             //   (s + ~a + y) (~s + ~b + y) (s + a + ~y) (~s + b + ~y)
 
             assert(inputs.size() == 3);
-            assert(map.find(inputs[0]) != map.end());
-            assert(map.find(inputs[1]) != map.end());
-            assert(map.find(inputs[2]) != map.end());
-            Lit s = mkLit(map[inputs[0]]);
-            Lit a = mkLit(map[inputs[1]]);
-            Lit b = mkLit(map[inputs[2]]);
-
-            assert(map.find(output) != map.end());
-            Lit y = mkLit(map[output]);
+            Lit s = mkLit(node_var(map, inputs[0]));
+            Lit a = mkLit(node_var(map, inputs[1]));
+            Lit b = mkLit(node_var(map, inputs[2]));
+
+            Lit y = mkLit(node_var(map, output));
 
             //   (s + ~a + y) 
             S.addClause(s, ~a, y);
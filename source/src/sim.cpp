@@ -1,7 +1,8 @@
 #include "sim.h"
 #include "util.h"
-#include <unordered_map>
-#include <map>
+#include <algorithm>
+#include <omp.h>
+#include <math.h>
 
 // JOHANN
 #include <chrono>
@@ -245,6 +246,46 @@ namespace ckt_n {
 	}
     }
 
+    ckt_eval_t::ckt_eval_t(ckt_t& c, nodelist_t& inps, unsigned words)
+        : ckt(c)
+        , inputs(inps)
+        , bsim(c)
+    {
+        seed(time_seed());
+
+        bsim.init_frame(frame, words);
+        bsim.init_frame(single, 1);
+        frames.resize(omp_get_max_threads());
+        for(unsigned t=0; t != frames.size(); t++) {
+            bsim.init_frame(frames[t], words);
+        }
+
+        for(unsigned i=0; i != c.num_key_inputs(); i++) {
+            set_cnst(c.key_inputs[i], 0);
+        }
+    }
+
+    void ckt_eval_t::seed(uint64_t s)
+    {
+        seed_value = s;
+        sampled = 0;
+        last_samples = 0;
+        total_samples = 0;
+        rng.seed_with(s);
+    }
+
+    void ckt_eval_t::set_cnst(node_t* n, int val)
+    {
+        assert(n->is_keyinput());
+        assert(val == 0 || val == 1);
+
+        bsim.set_value(frame, n->get_index(), val == 1);
+        bsim.set_value(single, n->get_index(), val == 1);
+        for(unsigned t=0; t != frames.size(); t++) {
+            bsim.set_value(frames[t], n->get_index(), val == 1);
+        }
+    }
+
     void ckt_eval_t::eval(
         const std::vector<bool>& input_values,
         std::vector<bool>& output_values
@@ -254,97 +295,293 @@ namespace ckt_n {
 	    //
 	    // sample the output for the input several times, and pick only the most common observation as ground truth to be used for further SAT solving
 	    //
-	    if (sim.ckt.IO_sampling_flag) {
+	    if (ckt.IO_sampling_flag) {
+		    _sample(input_values, output_values);
+	    }
+
+	    // JOHANN
+	    // original code, calls evaluation only once
+	    //
+	    else {
+		    assert(inputs.size() == input_values.size());
+		    for (unsigned i = 0; i != inputs.size(); i++) {
+			    bsim.set_value(single, inputs[i]->get_index(), input_values[i]);
+		    }
+		    bsim.eval(single, rng);
+		    bsim.get_outputs(single, 0, output_values);
+		    last_samples = 1;
+		    total_samples++;
+	    }
+    }
 
-		    std::unordered_map<std::vector<bool>, unsigned> output_samples_counts;
-		    std::multimap<unsigned, std::vector<bool>, std::greater<unsigned>> output_samples_sorted;
+    void ckt_eval_t::eval(
+        const std::vector<bool_vec_t>& input_values,
+        std::vector<bool_vec_t>& output_values
+    )
+    {
+        output_values.resize(input_values.size());
 
-		    // sample outputs N times (for the same input), track the counts of the different observed output patterns, select the most promising one as ground truth for
-		    // this input pattern
-		    //
-		    for (unsigned i = 0; i < sim.ckt.IO_sampling_iter; i++) {
+        // each pattern needs its own lanes for sampling
+        if (ckt.IO_sampling_flag) {
+            for (unsigned p = 0; p != input_values.size(); p++) {
+                _sample(input_values[p], output_values[p]);
+            }
+            return;
+        }
 
-			    sim.eval(inputs, input_values, output_values);
+        const unsigned lanes = frame.lanes();
+        for (unsigned base = 0; base < input_values.size(); base += lanes) {
+            unsigned n = std::min<unsigned>(lanes, input_values.size() - base);
 
-			    // first occurrence of this pattern, init map for this key/pattern
-			    if (output_samples_counts.find(output_values) == output_samples_counts.end()) {
-				    output_samples_counts[output_values] = 1;
-			    }
-			    else {
-				    output_samples_counts[output_values]++;
-			    }
+            for (unsigned l = 0; l != n; l++) {
+                const bool_vec_t& in = input_values[base + l];
+                assert(inputs.size() == in.size());
+                for (unsigned i = 0; i != inputs.size(); i++) {
+                    bsim.set_value(frame, inputs[i]->get_index(), l, in[i]);
+                }
+            }
+            bsim.eval(frame, rng);
+            for (unsigned l = 0; l != n; l++) {
+                bsim.get_outputs(frame, l, output_values[base + l]);
+            }
+        }
+    }
 
-			    if (ckt_n::DBG_VERBOSE) {
-				    std::cout << "Output: " << output_values << std::endl;
-				    std::cout << " Samples count: " << output_samples_counts[output_values] << std::endl;
-			    }
+    void ckt_eval_t::_sample(const bool_vec_t& input_values, bool_vec_t& output_values)
+    {
+	    assert(inputs.size() == input_values.size());
+
+	    // without any stochastic gates, all the samples are the same
+	    if (!bsim.stochastic) {
+		    for (unsigned i = 0; i != inputs.size(); i++) {
+			    bsim.set_value(single, inputs[i]->get_index(), input_values[i]);
 		    }
+		    bsim.eval(single, rng);
+		    bsim.get_outputs(single, 0, output_values);
+		    last_samples = 1;
+		    total_samples++;
+		    return;
+	    }
 
-		    // convert sample counts into sorted multimap, with highest counts coming first
-		    //
-		    for (auto const& count : output_samples_counts) {
+	    // the same input pattern is applied to all lanes, each lane is one sample; sample outputs N times (for the same input), track the counts of the different
+	    // observed output patterns, select the most promising one as ground truth for this input pattern
+	    //
+	    const unsigned samples_max = std::max(1u, ckt.IO_sampling_iter);
+	    const unsigned lanes = frame.lanes();
+	    const int batches = (samples_max + lanes - 1) / lanes;
+	    const uint64_t stream = seed_value + (sampled++ << 32);
+	    const unsigned num_outputs = ckt.num_outputs();
+
+	    // the thread count may have changed since construction
+	    while (frames.size() < (unsigned) omp_get_max_threads()) {
+		    frames.push_back(frame);
+	    }
 
-			    output_samples_sorted.emplace(std::make_pair(
-						    count.second,
-						    count.first
-					    ));
-		    }
+	    // in adaptive mode, the batches are simulated in rounds of one batch per thread, and the sampling stops after the first batch for which the
+	    // dominance of the most common pattern is decided; otherwise all batches are simulated in one go. the batches are always accumulated in order,
+	    // so where the sampling stops doesn't depend on the number of threads
+	    const int round_size = ckt.IO_sampling_adaptive_flag ? frames.size() : batches;
+	    if (batch_hists.size() < (unsigned) round_size) {
+		    batch_hists.resize(round_size);
+	    }
+	    for (int b = 0; b < round_size; b++) {
+		    batch_hists[b].init(num_outputs, lanes);
+	    }
+	    hist.init(num_outputs, samples_max);
 
-		    if (ckt_n::DBG) {
-			    for (auto const& sample : output_samples_sorted) {
-				    std::cout << "Output: " << sample.second << std::endl;
-				    std::cout << " Samples count: " << sample.first << std::endl;
-			    }
-		    }
+	    unsigned samples = 0;
+	    bool decided = false;
 
-		    // in case the most common pattern is dominant, i.e., occurs more frequently than the next two patterns taken together, consider it directly as ground truth
-		    auto iter = output_samples_sorted.begin();
-		    unsigned first = (*iter).first;
-		    ++iter;
-		    unsigned second_third = (*iter).first;
-		    ++iter;
-		    second_third += (*iter).first;
+	    for (int b0 = 0; b0 < batches && !decided; b0 += round_size) {
+		    const int b1 = std::min(batches, b0 + round_size);
 
-		    if (first > second_third) {
-			output_values = (*output_samples_sorted.begin()).second;
-		    }
-		    // otherwise, even the most common pattern is not dominant
-		    // then, randomly select a pattern based on its occurrence
-		    // (the higher its count, the more likely a pattern will be chosen)
-		    //
-		    else {
-			    // the random value is between [0, N]; the pattern which falls within that range will be picked
-			    unsigned r = rand() % (sim.ckt.IO_sampling_iter + 1);
-			    if (ckt_n::DBG) {
-				    std::cout << "r: " << r << std::endl;
+		    #pragma omp parallel for schedule(static) if(b1 - b0 > 1)
+		    for (int b = b0; b < b1; b++) {
+			    bitsim_t::frame_t& f = frames[omp_get_thread_num()];
+			    output_hist_t& h = batch_hists[b - b0];
+			    rng_t batch_rng(stream + b);
+			    std::vector<uint64_t> key(h.words);
+
+			    h.clear();
+			    for (unsigned i = 0; i != inputs.size(); i++) {
+				    bsim.set_value(f, inputs[i]->get_index(), input_values[i]);
 			    }
+			    bsim.eval(f, batch_rng);
 
-			    unsigned count = 0;
-			    for (auto const& sample : output_samples_sorted) {
+			    unsigned n = std::min(lanes, samples_max - b * lanes);
+			    for (unsigned l = 0; l != n; l++) {
+				    bsim.get_outputs(f, l, &key[0]);
+				    h.add(&key[0]);
+			    }
+		    }
 
-				    count +=  sample.first;
+		    // reduce the per-batch counts
+		    for (int b = b0; b < b1 && !decided; b++) {
+			    hist.add(batch_hists[b - b0]);
+			    samples += std::min(lanes, samples_max - b * lanes);
 
-				    // the first pattern where the cumulative count goes just at or beyond the random value should be the one to pick; this is to mimic a random
-				    // selection weighted by the counts
-				    if (count >= r) {
-					    output_values = sample.second;
-					    break;
-				    }
+			    if (ckt.IO_sampling_adaptive_flag) {
+				    decided = _decided(hist, samples, b + 1);
 			    }
 		    }
-		    
-		    if (ckt_n::DBG) {
-			    std::cout << "Consider output: " << output_values << std::endl;
-			    std::cout << std::endl;
+	    }
+	    last_samples = samples;
+	    total_samples += samples;
+
+	    if (ckt_n::DBG) {
+		    for (unsigned slot : hist.used) {
+			    hist.get_pattern(slot, num_outputs, output_values);
+			    std::cout << "Output: " << output_values << std::endl;
+			    std::cout << " Samples count: " << hist.count(slot) << std::endl;
 		    }
 	    }
 
-	    // JOHANN
-	    // original code, calls evaluation only once
+	    // in case the most common pattern is dominant, i.e., occurs more frequently than the next two patterns taken together, consider it directly as ground truth
+	    unsigned first = hist.top_count(0);
+	    unsigned second_third = hist.top_count(1) + hist.top_count(2);
+
+	    if (first > second_third) {
+		hist.get_pattern(hist.top[0], num_outputs, output_values);
+	    }
+	    // otherwise, even the most common pattern is not dominant
+	    // then, randomly select a pattern based on its occurrence
+	    // (the higher its count, the more likely a pattern will be chosen)
 	    //
 	    else {
-		    sim.eval(inputs, input_values, output_values);
+		    // the random value is between [0, N]; the pattern which falls within that range will be picked
+		    unsigned r = rng.next() % (samples + 1);
+		    if (ckt_n::DBG) {
+			    std::cout << "r: " << r << std::endl;
+		    }
+
+		    unsigned count = 0;
+		    for (unsigned slot : hist.used) {
+
+			    count += hist.count(slot);
+
+			    // the first pattern where the cumulative count goes just at or beyond the random value should be the one to pick; this is to mimic a random
+			    // selection weighted by the counts
+			    if (count >= r) {
+				    hist.get_pattern(slot, num_outputs, output_values);
+				    break;
+			    }
+		    }
 	    }
+	    
+	    if (ckt_n::DBG) {
+		    std::cout << "Consider output: " << output_values << std::endl;
+		    std::cout << std::endl;
+	    }
+    }
+
+    // sequential test for the dominance of the most common pattern: with x = +1 for samples of the most common pattern, x = -1 for the next two
+    // patterns, and x = 0 otherwise, the pattern is dominant iff the mean of x is positive. the Hoeffding bound, with the error budget split over
+    // all checks as alpha * 6 / (pi^2 * check^2), says whether the sign of the mean is decided yet, in either direction
+    //
+    bool ckt_eval_t::_decided(const output_hist_t& h, unsigned samples, unsigned check) const
+    {
+	    double alpha = ckt.IO_sampling_adaptive_error / 100.0;
+	    double mean = (static_cast<double>(h.top_count(0)) - h.top_count(1) - h.top_count(2)) / samples;
+	    double bound = std::sqrt(2.0 * std::log(M_PI * M_PI * check * check / (3.0 * alpha)) / samples);
+
+	    return std::fabs(mean) > bound;
+    }
+
+    void output_hist_t::init(unsigned num_outputs, unsigned max_patterns)
+    {
+        unsigned w = std::max(1u, (num_outputs + 63) / 64);
+        unsigned slots = 16;
+        while (slots < 2 * max_patterns) slots <<= 1;
+
+        // keep the table if it's large enough
+        if (w == words && slots <= counts.size()) {
+            clear();
+            return;
+        }
+
+        words = w;
+        mask = slots - 1;
+        keys.assign(slots * words, 0);
+        fingerprints.assign(slots, 0);
+        counts.assign(slots, 0);
+        used.clear();
+        used.reserve(max_patterns);
+        top[0] = top[1] = top[2] = -1;
+    }
+
+    void output_hist_t::clear()
+    {
+        for (unsigned slot : used) {
+            counts[slot] = 0;
+        }
+        used.clear();
+        top[0] = top[1] = top[2] = -1;
+    }
+
+    unsigned output_hist_t::_find(const uint64_t* key, uint64_t fp)
+    {
+        unsigned slot = fp & mask;
+        while (counts[slot] != 0) {
+            if (fingerprints[slot] == fp && std::equal(key, key + words, &keys[slot * words])) {
+                return slot;
+            }
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    void output_hist_t::_update_top(int slot)
+    {
+        // counts only ever grow, so the slot can only move up
+        int pos = 0;
+        while (pos != 3 && top[pos] != slot) pos++;
+        if (pos == 3) {
+            if (top[2] != -1 && counts[top[2]] >= counts[slot]) {
+                return;
+            }
+            pos = 2;
+            top[2] = slot;
+        }
+        while (pos > 0 && (top[pos-1] == -1 || counts[top[pos-1]] < counts[slot])) {
+            std::swap(top[pos-1], top[pos]);
+            pos--;
+        }
+    }
+
+    void output_hist_t::add(const uint64_t* key, unsigned count)
+    {
+        uint64_t fp = 0x9E3779B97F4A7C15ULL;
+        for (unsigned i = 0; i != words; i++) {
+            fp = (fp ^ key[i]) * 0xBF58476D1CE4E5B9ULL;
+            fp ^= fp >> 31;
+        }
+
+        unsigned slot = _find(key, fp);
+        if (counts[slot] == 0) {
+            assert(used.size() < mask);
+            std::copy(key, key + words, &keys[slot * words]);
+            fingerprints[slot] = fp;
+            used.push_back(slot);
+        }
+        counts[slot] += count;
+        _update_top(slot);
+    }
+
+    void output_hist_t::add(const output_hist_t& h)
+    {
+        assert(h.words == words);
+        for (unsigned slot : h.used) {
+            add(h.key(slot), h.count(slot));
+        }
+    }
+
+    void output_hist_t::get_pattern(unsigned slot, unsigned num_outputs, bool_vec_t& outputs) const
+    {
+        const uint64_t* k = key(slot);
+        outputs.resize(num_outputs);
+        for (unsigned i = 0; i != num_outputs; i++) {
+            outputs[i] = (k[i / 64] >> (i % 64)) & 1;
+        }
     }
 
     void convert(uint64_t v, bool_vec_t& result)
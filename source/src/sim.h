@@ -5,6 +5,7 @@
 #include "ckt.h"
 #include "util.h"
 #include "SATInterface.h"
+#include "bitsim.h"
 
 namespace ckt_n {
     typedef std::vector<bool> bool_vec_t;
@@ -33,24 +34,87 @@ namespace ckt_n {
         void eval(nodelist_t& input_nodes, const bool_vec_t& input_values, bool_vec_t& outputs);
     };
 
+    // histogram of output patterns for I/O sampling. the patterns are packed
+    // into words and kept in a flat open-addressing table, with a 64-bit
+    // fingerprint per slot to skip most key comparisons; the three highest
+    // counts are tracked as the patterns are added.
+    struct output_hist_t {
+        unsigned                words;
+        unsigned                mask;
+        std::vector<uint64_t>   keys;
+        std::vector<uint64_t>   fingerprints;
+        std::vector<unsigned>   counts;
+        // slots in use, in the order of insertion.
+        std::vector<unsigned>   used;
+        // slots with the three highest counts, or -1.
+        int                     top[3];
+
+        output_hist_t() : words(0), mask(0) {}
+
+        // size the table for at most max_patterns distinct patterns.
+        void init(unsigned num_outputs, unsigned max_patterns);
+        void clear();
+
+        void add(const uint64_t* key, unsigned count = 1);
+        void add(const output_hist_t& h);
+
+        unsigned size() const { return used.size(); }
+        unsigned count(unsigned slot) const { return counts[slot]; }
+        unsigned top_count(unsigned i) const { return top[i] == -1 ? 0 : counts[top[i]]; }
+        const uint64_t* key(unsigned slot) const { return &keys[slot * words]; }
+        void get_pattern(unsigned slot, unsigned num_outputs, bool_vec_t& outputs) const;
+
+    private:
+        unsigned _find(const uint64_t* key, uint64_t fp);
+        void _update_top(int slot);
+    };
+
+    // evaluates the circuit (the oracle) using the word-parallel simulator;
+    // key inputs are tied to constants. with I/O sampling enabled, the
+    // samples for one input pattern are drawn from the lanes of the simulator,
+    // and batches of lanes are spread over the OpenMP threads. every batch
+    // has its own random stream, derived from the seed, the number of the
+    // sampled pattern and the batch, so the results for a given seed don't
+    // depend on the number of threads.
     struct ckt_eval_t : public simulator_t {
-        eval_t sim;
+        ckt_t& ckt;
         nodelist_t& inputs;
+        bitsim_t bsim;
+        bitsim_t::frame_t frame;
+        bitsim_t::frame_t single;
+        // one frame per thread for sampling.
+        std::vector<bitsim_t::frame_t> frames;
+        rng_t rng;
+        uint64_t seed_value;
+        uint64_t sampled;
+        // output samples drawn for the last sampled pattern, and in total.
+        unsigned last_samples;
+        uint64_t total_samples;
+        // histograms per batch of a sampling round, and for the pattern.
+        std::vector<output_hist_t> batch_hists;
+        output_hist_t hist;
 
-        ckt_eval_t(ckt_t& c, nodelist_t& inps) 
-            : sim(c)
-            , inputs(inps)
-        {
-            for(unsigned i=0; i != c.num_key_inputs(); i++) {
-                set_cnst(c.key_inputs[i], 0);
-            }
-        }
+        ckt_eval_t(ckt_t& c, nodelist_t& inps, unsigned words = bitsim_t::DEFAULT_WORDS);
 
-        void set_cnst(node_t* n, int val) { sim.set_cnst(n, val); }
+        void seed(uint64_t s);
+        void set_cnst(node_t* n, int val);
         virtual void eval(
             const std::vector<bool>& inputs,
             std::vector<bool>& outputs
         );
+        // evaluate several input patterns at once, packed into the lanes of
+        // the simulator. the results are the same as calling eval() for each
+        // of the patterns in turn.
+        void eval(
+            const std::vector<bool_vec_t>& inputs,
+            std::vector<bool_vec_t>& outputs
+        );
+
+        unsigned lanes() const { return frame.lanes(); }
+
+    private:
+        void _sample(const bool_vec_t& input_values, bool_vec_t& output_values);
+        bool _decided(const output_hist_t& h, unsigned samples, unsigned check) const;
     };
 
     void convert(uint64_t v, bool_vec_t& result);
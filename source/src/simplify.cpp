@@ -13,14 +13,9 @@ int simplify_main(int argc, char* argv[])
         return 1;
     }
 
-    yyin = fopen(argv[1], "rt");
-    if(yyin == NULL) {
-        perror(argv[1]);
-        return 1;
-    }
-    if(yyparse() == 0) {
-        using namespace ast_n;
-        ckt_n::ckt_t ckt(*statements);
+    ckt_n::bench_file_t bench;
+    if(bench.read(argv[1])) {
+        ckt_n::ckt_t ckt(bench);
         std::vector<sat_n::lbool> keyvector(ckt.num_key_inputs(), sat_n::l_False);
         if(argc == 3) {
             if(strstr(argv[2], "key=") != argv[2]) {
@@ -1,6 +1,7 @@
 #include <iostream>
 #include <fstream>
 #include <iomanip>
+#include <sstream>
 #include <unistd.h>
 #include <stdio.h>
 #include <signal.h>
@@ -8,7 +9,6 @@
 #include <sys/resource.h>
 #include <algorithm>
 #include <boost/algorithm/string/predicate.hpp>
-#include "ast.h"
 #include "ckt.h"
 #include "dbl.h"
 #include "sim.h"
@@ -30,17 +30,62 @@ int print_info = 0;
 int slice = 0;
 int tv_quit = 0;
 int more_keys = 1;
+uint64_t rnd_seed = 0;
+int portfolio = 1;
+int dip_batch = 1;
+int warm_patterns = 0;
+std::vector<sat_n::backend_kind_t> sat_backends;
+std::string stats_file;
+int use_ckt_cache = 0;
+std::string ckt_cache_dir;
+std::string checkpoint_file;
+std::string resume_file;
+double checkpoint_interval = 60;
+double approx_error = 0;
+int approx_interval = 10;
+int approx_compare = 0;
 
 volatile solver_t* solver = NULL;
 std::string known_keystring;
 
+// read a circuit and, if stoch_file isn't empty, its stochastic gates.
+// with -z/-Z, the binary image of the circuit is used if it's up to date,
+// and written otherwise.
+static ckt_n::ckt_t* read_ckt(const std::string& bench_file, const std::string& stoch_file)
+{
+    using namespace ckt_n;
+
+    std::string cache_file;
+    if(use_ckt_cache) {
+        cache_file = ckt_cache_t::cache_path(ckt_cache_dir, bench_file, stoch_file);
+        ckt_cache_t cache;
+        if(cache.load(cache_file, bench_file, stoch_file)) {
+            return new ckt_t(cache);
+        }
+    }
+
+    bench_file_t bench;
+    if(!bench.read(bench_file)) {
+        return NULL;
+    }
+    ckt_t* ckt = new ckt_t(bench);
+    bench.close();
+    if(stoch_file.size()) {
+        ckt->readStochFile(stoch_file);
+    }
+    if(use_ckt_cache) {
+        ckt_cache_t::save(cache_file, *ckt, bench_file, stoch_file);
+    }
+    return ckt;
+}
+
 int sld_main(int argc, char* argv[]) 
 {
     char c;
     int cpu_limit = -1;
     int64_t data_limit = -1;
 
-    while ((c = getopt (argc, argv, "ihvptTc:m:k:sN:")) != -1) {
+    while ((c = getopt (argc, argv, "ihvptTc:m:k:sN:r:l:P:D:W:C:I:R:a:A:xb:zZ:")) != -1) {
         switch (c) {
             case 'h':
                 return print_usage(argv[0]);
@@ -75,6 +120,71 @@ int sld_main(int argc, char* argv[])
             case 'N':
                 more_keys = atoi(optarg);
                 break;
+            case 'r':
+                rnd_seed = strtoull(optarg, NULL, 10);
+                break;
+            case 'l':
+                stats_file = optarg;
+                break;
+            case 'P':
+                portfolio = atoi(optarg);
+                break;
+            case 'D':
+                dip_batch = atoi(optarg);
+                if(dip_batch < 1) {
+                    std::cerr << "Error: the number of DIPs per iteration must be at least 1." << std::endl;
+                    return 1;
+                }
+                break;
+            case 'W':
+                warm_patterns = atoi(optarg);
+                break;
+            case 'C':
+                checkpoint_file = optarg;
+                break;
+            case 'I':
+                checkpoint_interval = atof(optarg);
+                break;
+            case 'R':
+                resume_file = optarg;
+                break;
+            case 'a':
+                approx_error = atof(optarg);
+                break;
+            case 'A':
+                approx_interval = atoi(optarg);
+                if(approx_interval < 1) {
+                    std::cerr << "Error: the interval of the error estimates must be at least 1." << std::endl;
+                    return 1;
+                }
+                break;
+            case 'x':
+                approx_compare = 1;
+                break;
+            case 'b':
+                {
+                    std::istringstream names(optarg);
+                    std::string name;
+                    sat_n::backend_kind_t kind;
+                    while(std::getline(names, name, ',')) {
+                        if(!sat_n::parseBackend(name, kind)) {
+                            std::cerr << "Error: unknown SAT backend " << name << "." << std::endl;
+                            return 1;
+                        }
+                        sat_backends.push_back(kind);
+                    }
+                    if(sat_backends.size()) {
+                        sat_n::setDefaultBackend(sat_backends[0]);
+                    }
+                }
+                break;
+            case 'z':
+                use_ckt_cache = 1;
+                break;
+            case 'Z':
+                use_ckt_cache = 1;
+                ckt_cache_dir = optarg;
+                break;
             default:
                 break;
         }
@@ -105,38 +215,30 @@ int sld_main(int argc, char* argv[])
     // try to open the verilog file.
     //
     // JOHANN
-    // the encrypted benchfile
-    yyin = fopen(argv[optind], "rt");
-    if(yyin == NULL) {
-        perror(argv[optind]);
-        return 1;
+    // the encrypted benchfile, and the original benchfile along with the
+    // .stoch file, which defines the stochastic gates and their error rate
+    // the two circuits are independent, so they are read concurrently.
+    std::string stoch_file = std::string(argv[optind]) + ".stoch";
+    ckt_n::ckt_t *enc_ckt = NULL, *sim_ckt = NULL;
+    #pragma omp parallel sections
+    {
+        #pragma omp section
+        enc_ckt = read_ckt(argv[optind], "");
+        #pragma omp section
+        sim_ckt = read_ckt(argv[optind+1], stoch_file);
+    }
+    if(sim_ckt) {
+        sim_ckt->print_stoch_summary(stoch_file);
     }
 
-    if(yyparse() == 0) {
-        using namespace ast_n;
-        ckt_n::ckt_t ckt(*statements);
-        delete statements;
-        fclose(yyin);
+    if(enc_ckt) {
+        ckt_n::ckt_t& ckt = *enc_ckt;
 
         // read the circuit for simulation.
-	//
-	// JOHANN
-	// the original benchfile
-        yyin = fopen(argv[optind+1], "rt");
-        if(yyin == NULL) {
-            perror(argv[optind+1]);
-            return 1;
-        }
-        if(yyparse() != 0) {
+        if(!sim_ckt) {
             return 1;
         }
-        ckt_n::ckt_t simckt(*statements);
-        delete statements;
-        fclose(yyin);
-
-	// JOHANN
-	// also read in the .stoch file, which defines the stochastic gates and their error rate
-	simckt.readStochFile(std::string(argv[optind]) + ".stoch");
+        ckt_n::ckt_t& simckt = *sim_ckt;
 
         if(simckt.num_key_inputs() != 0) {
             std::cout << "Error. Circuit for simulation musn't have key inputs." << std::endl;
@@ -160,8 +262,12 @@ int sld_main(int argc, char* argv[])
         } else {
             solve(ckt, simckt);
         }
+    } else {
+        return 1;
     }
 
+    delete enc_ckt;
+    delete sim_ckt;
     return 0;
 }
 
@@ -201,6 +307,9 @@ int tv_solve(std::map<std::string, int>& keysFound, ckt_n::ckt_t& ckt, ckt_n::ck
     using namespace ckt_n;
 
     ckt_eval_t sim(simckt, simckt.ckt_inputs);
+    if(rnd_seed) {
+        sim.seed(rnd_seed);
+    }
     int newlyFound = 0, iter = 0, foundCnt = 0;
     do {
 
@@ -284,6 +393,21 @@ void solve(ckt_n::ckt_t& ckt, ckt_n::ckt_t& simckt)
     }
 
 
+    // a resumed attack has to start from the same known keys.
+    solver_t::checkpoint_t checkpoint;
+    if(resume_file.size()) {
+        if(!checkpoint.read(resume_file)) {
+            exit(1);
+        }
+        if(known_keystring.size() == 0) {
+            known_keystring = checkpoint.known_keys;
+        } else if(known_keystring != checkpoint.known_keys) {
+            std::cerr << "Error. The known keys differ from the ones of the checkpoint (" 
+                      << checkpoint.known_keys << ")." << std::endl;
+            exit(1);
+        }
+    }
+
     if(known_keystring.size()) {
         // TODO: refactor this to use maps.
         if(known_keystring.size() != ckt.num_key_inputs()) {
@@ -324,8 +448,22 @@ void solve(ckt_n::ckt_t& ckt, ckt_n::ckt_t& simckt)
 
     solver_t S(ckt, simckt, verbose);
     solver = &S;
+    S.checkpoint_file = checkpoint_file;
+    S.checkpoint_interval = checkpoint_interval;
+    S.known_keys = known_keystring;
+    if(resume_file.size()) {
+        S.resume(checkpoint);
+    }
     S.solve(solver_t::SOLVER_V0, keysFound, false);
     dump_keys(keyNames, keysFound);
+    if(stats_file.size()) {
+        std::ofstream out(stats_file.c_str());
+        if(!out) {
+            std::cerr << "Error. Unable to open " << stats_file << "." << std::endl;
+        } else {
+            S.dumpIterStats(out, boost::algorithm::ends_with(stats_file, ".json"));
+        }
+    }
 //JOHANN
 std::cout << std::endl;
     for(int i=1; i < more_keys; i++) {
@@ -370,6 +508,24 @@ int print_usage(const char* progname)
     std::cout << "    -k <keystr>   : provide known keys." << std::endl;
     std::cout << "    -s            : enable slicing and dicing." << std::endl;
     std::cout << "    -N            : extract N keys (default=1)." << std::endl;
+    std::cout << "    -r <seed>     : random seed (default: from the clock)." << std::endl;
+    std::cout << "    -l <file>     : write per-iteration statistics (CSV, or JSON for *.json)." << std::endl;
+    std::cout << "    -b <solvers>  : SAT solver(s): lingeling (default), cmsat or minisat; a" << std::endl;
+    std::cout << "                    comma-separated list runs a portfolio of these." << std::endl;
+    std::cout << "    -P <n>        : run a portfolio of n SAT solvers in parallel (default=1)." << std::endl;
+    std::cout << "    -D <n>        : find up to n DIPs per iteration and query the oracle" << std::endl;
+    std::cout << "                    for them as one batch (default=1)." << std::endl;
+    std::cout << "    -W <n>        : before the first iteration, simulate n random patterns" << std::endl;
+    std::cout << "                    and add the ones eliminating the most keys (default=0)." << std::endl;
+    std::cout << "    -C <file>     : write checkpoints of the attack to file." << std::endl;
+    std::cout << "    -I <sec>      : minimum time between checkpoints (default=60)." << std::endl;
+    std::cout << "    -R <file>     : resume the attack from a checkpoint." << std::endl;
+    std::cout << "    -a <err>      : stop once the output error rate (%) of the current key" << std::endl;
+    std::cout << "                    is below err, with 95% confidence." << std::endl;
+    std::cout << "    -A <n>        : estimate the error every n iterations (default=10)." << std::endl;
+    std::cout << "    -x            : with -a, run the exact attack anyway, to report the time saved." << std::endl;
+    std::cout << "    -z            : cache the parsed circuits next to the bench files." << std::endl;
+    std::cout << "    -Z <dir>      : cache the parsed circuits in dir." << std::endl;
 
     return 0;
 }
@@ -10,14 +10,20 @@
 
 #include <iostream>
 
-extern int yyparse();
-extern FILE* yyin;
 extern int verbose;
 extern int progress;
 extern volatile solver_t* solver;
 extern int backbones;
 extern int PRINT_INTERVAL;
 extern int version;
+extern uint64_t rnd_seed;
+extern int portfolio;
+extern int dip_batch;
+extern int warm_patterns;
+extern double approx_error;
+extern int approx_interval;
+extern int approx_compare;
+extern std::vector<sat_n::backend_kind_t> sat_backends;
 
 int print_usage(const char* progname);
 void test_ckt(ckt_n::ckt_t& ckt);
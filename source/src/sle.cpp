@@ -128,21 +128,14 @@ int sle_main(int argc, char* argv[])
         }
     }
 
-    yyin = fopen(argv[optind], "rt");
-    if(yyin == NULL) {
-        perror(argv[optind]);
-        return 1;
-    }
-
-    if(yyparse() == 0) {
-        using namespace ast_n;
-
+    ckt_n::bench_file_t bench;
+    if(bench.read(argv[optind])) {
         if(iolts14_enc) {
             if(key_fraction == 0.0) {
                 std::cerr << "Error: must specify fraction to insert. " << std::endl;
                 exit(1);
             }
-            ckt_n::toc13enc_t tenc(*statements, key_fraction);
+            ckt_n::toc13enc_t tenc(bench, key_fraction);
             tenc.encodeIOLTS14();
             if(output_file.size() == 0) {
                 tenc.write(std::cout);
@@ -155,7 +148,7 @@ int sle_main(int argc, char* argv[])
                 std::cerr << "Error: must specify fraction to insert. " << std::endl;
                 exit(1);
             }
-            ckt_n::toc13enc_t tenc(*statements, key_fraction);
+            ckt_n::toc13enc_t tenc(bench, key_fraction);
             if(fault_impact_file.size() == 0) {
                 tenc.evaluateFaultImpact(5000);
             } else {
@@ -178,7 +171,7 @@ int sle_main(int argc, char* argv[])
                 std::cerr << "Error: must specify fraction to insert. " << std::endl;
                 exit(1);
             }
-            ckt_n::ilp_encoder_t ioenc(*statements, key_fraction);
+            ckt_n::ilp_encoder_t ioenc(bench, key_fraction);
             ioenc.encode3();
             if(output_file.size() == 0) {
                 ioenc.write(std::cout);
@@ -203,11 +196,11 @@ int sle_main(int argc, char* argv[])
                 std::cerr << "Error: must specify fraction to insert. " << std::endl;
                 exit(1);
             }
-            ckt_n::dac12enc_t denc(*statements, graph, clique, key_fraction);
+            ckt_n::dac12enc_t denc(bench, graph, clique, key_fraction);
             std::ofstream fout(output_file.c_str());
             denc.write(fout);
         } else if(mutability.size()) {
-            ckt_n::ckt_t ckt(*statements);
+            ckt_n::ckt_t ckt(bench);
 
             std::ofstream fout(mutability.c_str());
             ckt_n::mutability_analysis_t mut(ckt, fout);
@@ -219,7 +212,7 @@ int sle_main(int argc, char* argv[])
             if(target_keys == -1 && key_fraction == 0.0) {
                 std::cerr << "Error, must specify target number of keys with -k <keys> or -f <fraction> flag." << std::endl;
             }
-            ckt_n::ckt_t ckt(*statements);
+            ckt_n::ckt_t ckt(bench);
 
             if(key_fraction != 0.0) {
                 target_keys = (int) (ckt.num_gates() * key_fraction + 0.5);
@@ -8,6 +8,10 @@
 
 #include <iterator>
 #include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+#include <string.h>
 #include <boost/lexical_cast.hpp>
 
 #include <ilcplex/ilocplex.h>
@@ -18,9 +22,11 @@ solver_t::solver_t(ckt_n::ckt_t& c, ckt_n::ckt_t& s, int verb)
     , simckt(s)
     , sim(s, s.ckt_inputs)
     , dbl(c, ckt_n::dup_allkeys, true)
+    , tsim(c)
     , input_values(ckt.num_ckt_inputs(), false)
     , output_values(ckt.num_outputs(), false)
     , fixed_keys(ckt.num_key_inputs(), false)
+    , approx_sim(NULL)
     , verbose(verb)
     , iter(0)
     , backbones_count(0)
@@ -28,6 +34,7 @@ solver_t::solver_t(ckt_n::ckt_t& c, ckt_n::ckt_t& s, int verb)
 {
     MAX_VERIF_ITER = 1;
     time_limit = 1e100;
+    checkpoint_interval = 60;
 
     using namespace ckt_n;
     using namespace sat_n;
@@ -39,6 +46,15 @@ solver_t::solver_t(ckt_n::ckt_t& c, ckt_n::ckt_t& s, int verb)
     // dbl.dbl->split_gates();
     // dbl.dbl->dump(std::cout);
 
+    // the portfolio members have to be set up before any clauses are added.
+    if(sat_backends.size() > 1 || portfolio > 1) {
+        std::vector<backend_kind_t> kinds(std::max<size_t>(portfolio, sat_backends.size()));
+        for(unsigned i=0; i != kinds.size(); i++) {
+            kinds[i] = sat_backends.size() ? sat_backends[i % sat_backends.size()] : getDefaultBackend();
+        }
+        S.setPortfolio(kinds);
+    }
+
     dbl.dbl->init_solver(S, cl, lmap, true);
     node_t* out = dbl.dbl->outputs[0];
     l_out = lmap[out->get_index()];
@@ -81,13 +97,23 @@ solver_t::solver_t(ckt_n::ckt_t& c, ckt_n::ckt_t& s, int verb)
     dbl_keyinput_flags.resize(S.nVars(), false);
     dbl.dbl->init_keyinput_map(lmap, dbl_keyinput_flags);
 
+    // the keys stay unknown in the three-valued simulation.
+    tsim.init_frame(tsim_val, 1);
+    tsim.init_frame(tsim_known, 1);
+
     // JOHANN
     //
-	// init srand with long and high-resolution timing seed
+	// init srand with long and high-resolution timing seed, unless a seed is given
 	//
-	auto now = std::chrono::high_resolution_clock::now();
-	auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
-	srand(nanos);
+	if (rnd_seed) {
+		srand(rnd_seed);
+		sim.seed(rnd_seed);
+	}
+	else {
+		auto now = std::chrono::high_resolution_clock::now();
+		auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+		srand(nanos);
+	}
 }
 
 
@@ -108,8 +134,163 @@ void solver_t::addKnownKeys(std::vector<std::pair<int, int> >& values)
     }
 }
 
+namespace {
+    const char     CHECKPOINT_MAGIC[8] = { 'P', 'S', 'A', 'T', 'C', 'K', 'P', '\0' };
+    const uint32_t CHECKPOINT_VERSION = 1;
+
+    // followed by the known key string and then, for each pattern, the
+    // inputs and the outputs as bits packed into bytes.
+    struct checkpoint_header_t {
+        char        magic[8];
+        uint32_t    version;
+        uint32_t    num_inputs;
+        uint32_t    num_outputs;
+        uint32_t    num_keys;
+        uint32_t    iterations;
+        uint32_t    num_vectors;
+        uint32_t    known_keys_len;
+    };
+
+    void _pack(const std::vector<bool>& v, std::vector<char>& buf)
+    {
+        size_t pos = buf.size();
+        buf.resize(pos + (v.size() + 7) / 8, 0);
+        for(unsigned i=0; i != v.size(); i++) {
+            if(v[i]) buf[pos + i/8] |= 1 << (i % 8);
+        }
+    }
+
+    void _unpack(const char* data, unsigned n, std::vector<bool>& v)
+    {
+        v.resize(n);
+        for(unsigned i=0; i != n; i++) {
+            v[i] = (data[i/8] >> (i % 8)) & 1;
+        }
+    }
+}
+
+bool solver_t::checkpoint_t::read(const std::string& file)
+{
+    std::ifstream in(file.c_str(), std::ios::binary);
+    if(!in) {
+        std::cerr << "Error. Unable to open the checkpoint " << file << "." << std::endl;
+        return false;
+    }
+    checkpoint_header_t h;
+    if(!in.read((char*) &h, sizeof(h)) ||
+       memcmp(h.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0 ||
+       h.version != CHECKPOINT_VERSION)
+    {
+        std::cerr << "Error. " << file << " isn't a checkpoint of this version." << std::endl;
+        return false;
+    }
+    num_inputs = h.num_inputs;
+    num_outputs = h.num_outputs;
+    num_keys = h.num_keys;
+    iterations = h.iterations;
+
+    // the sizes in the header must fit the rest of the file before
+    // anything is allocated for them.
+    uint64_t vector_bytes = (uint64_t(num_inputs) + 7) / 8 + (uint64_t(num_outputs) + 7) / 8;
+    uint64_t need = h.known_keys_len + uint64_t(h.num_vectors) * vector_bytes;
+    std::streampos pos = in.tellg();
+    in.seekg(0, std::ios::end);
+    uint64_t left = in.tellg() - pos;
+    in.seekg(pos);
+    if(!in || need > left || (h.num_vectors && vector_bytes == 0)) {
+        std::cerr << "Error. The checkpoint " << file << " is truncated." << std::endl;
+        return false;
+    }
+
+    known_keys.resize(h.known_keys_len);
+    std::vector<char> buf(vector_bytes);
+    bool ok = !h.known_keys_len || in.read(&known_keys[0], h.known_keys_len);
+    iovectors.resize(h.num_vectors);
+    for(unsigned i=0; ok && i != h.num_vectors; i++) {
+        ok = (bool) in.read(&buf[0], buf.size());
+        _unpack(&buf[0], num_inputs, iovectors[i].inputs);
+        _unpack(&buf[(num_inputs + 7) / 8], num_outputs, iovectors[i].outputs);
+    }
+    if(!ok) {
+        std::cerr << "Error. The checkpoint " << file << " is truncated." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// The file is written under a temporary name and renamed, so a run that is
+// killed while writing leaves the previous checkpoint intact.
+bool solver_t::writeCheckpoint(const std::string& file) const
+{
+    checkpoint_header_t h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    h.version = CHECKPOINT_VERSION;
+    h.num_inputs = ckt.num_ckt_inputs();
+    h.num_outputs = ckt.num_outputs();
+    h.num_keys = ckt.num_key_inputs();
+    h.iterations = iter;
+    h.num_vectors = iovectors.size();
+    h.known_keys_len = known_keys.size();
+
+    std::vector<char> buf((const char*) &h, (const char*) (&h + 1));
+    buf.insert(buf.end(), known_keys.begin(), known_keys.end());
+    for(unsigned i=0; i != iovectors.size(); i++) {
+        _pack(iovectors[i].inputs, buf);
+        _pack(iovectors[i].outputs, buf);
+    }
+
+    std::ostringstream tmp;
+    tmp << file << ".tmp." << getpid();
+    std::string tmp_file = tmp.str();
+    {
+        std::ofstream out(tmp_file.c_str(), std::ios::binary);
+        if(out) {
+            out.write(&buf[0], buf.size());
+        }
+        if(!out) {
+            std::cerr << "Warning: unable to write the checkpoint " << tmp_file << "." << std::endl;
+            unlink(tmp_file.c_str());
+            return false;
+        }
+    }
+    if(rename(tmp_file.c_str(), file.c_str()) != 0) {
+        perror(file.c_str());
+        unlink(tmp_file.c_str());
+        return false;
+    }
+    return true;
+}
+
+void solver_t::resume(const checkpoint_t& cp)
+{
+    if(cp.num_inputs != ckt.num_ckt_inputs() ||
+       cp.num_outputs != ckt.num_outputs() ||
+       cp.num_keys != ckt.num_key_inputs())
+    {
+        std::cerr << "Error. The checkpoint was made for a circuit with " << cp.num_inputs << " inputs, "
+                  << cp.num_keys << " keys and " << cp.num_outputs << " outputs." << std::endl;
+        exit(1);
+    }
+    resume_vectors = cp.iovectors;
+    iter = cp.iterations;
+}
+
+void solver_t::_checkpoint(bool force)
+{
+    if(checkpoint_file.size() == 0) {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if(force || std::chrono::duration<double>(now - last_checkpoint).count() >= checkpoint_interval) {
+        writeCheckpoint(checkpoint_file);
+        last_checkpoint = now;
+    }
+}
+
 solver_t::~solver_t()
 {
+    if(approx_sim) delete approx_sim;
 }
 
 bool solver_t::solve(solver_t::solver_version_t ver, rmap_t& keysFound, bool quiet)
@@ -161,15 +342,321 @@ void solver_t::_record_sim(
     }
 }
 
+// Three-valued simulation of the locked circuit under the input values, with
+// the keys unknown. The gates whose values are known don't depend on the
+// keys; they are assigned in both copies, so that their clauses are skipped
+// when the circuit is rewritten, and only the key-dependent logic is added.
+// The outputs keep the values observed from the oracle.
+void solver_t::_propagate_constants(
+    const std::vector<bool>& input_values, 
+    std::vector<sat_n::lbool>& values
+)
+{
+    using namespace sat_n;
+    using namespace ckt_n;
+
+    for(unsigned i=0; i != input_values.size(); i++) {
+        int idx = ckt.ckt_inputs[i]->get_index();
+        tsim.set_value(tsim_val, idx, input_values[i]);
+        tsim.set_value(tsim_known, idx, true);
+    }
+    tsim.eval_ternary(tsim_val, tsim_known);
+
+    for(unsigned i=0; i != ckt.num_gates(); i++) {
+        node_t* g = ckt.gates[i];
+        int idx = g->get_index();
+        if(g->output || !tsim.get_value(tsim_known, idx, 0)) {
+            continue;
+        }
+
+        bool v = tsim.get_value(tsim_val, idx, 0);
+        Lit lA = lmap[dbl.pair_map[idx].first->get_index()];
+        Lit lB = lmap[dbl.pair_map[idx].second->get_index()];
+        assert(var(lA) < values.size() && var(lB) < values.size());
+        values[var(lA)] = (v ^ sign(lA)) ? l_True : l_False;
+        values[var(lB)] = (v ^ sign(lB)) ? l_True : l_False;
+    }
+}
+
 // Evaluates the output for the values stored in input_values and then records
 // this in the solver.
-void solver_t::_record_input_values()
+void solver_t::_record_input_values(iter_stats_t* stats)
 {
-    std::vector<sat_n::lbool> values(S.nVars(), sat_n::l_Undef);
+    auto t0 = std::chrono::steady_clock::now();
     sim.eval(input_values, output_values);
+    auto t1 = std::chrono::steady_clock::now();
+
+    if(stats) {
+        stats->oracle_time += std::chrono::duration<double>(t1 - t0).count();
+        stats->samples += sim.last_samples;
+    }
+    _record_io_values(input_values, output_values, stats);
+}
+
+void solver_t::_record_io_values(
+    const std::vector<bool>& input_values, 
+    const std::vector<bool>& output_values, 
+    iter_stats_t* stats
+)
+{
+    // only the variables of the doubled circuit are assigned, not the ones
+    // added for the earlier DIPs.
+    record_values.assign(cl.nVars(), sat_n::l_Undef);
+    std::vector<sat_n::lbool>& values = record_values;
+
+    auto t0 = std::chrono::steady_clock::now();
     _record_sim(input_values, output_values, values);
+    _propagate_constants(input_values, values);
     int cnt = cl.addRewrittenClauses(values, dbl_keyinput_flags, S);
+    auto t1 = std::chrono::steady_clock::now();
     __sync_fetch_and_add(&cube_count, cnt);
+
+    if(stats) {
+        stats->rewrite_time += std::chrono::duration<double>(t1 - t0).count();
+        stats->clauses_added += cnt;
+        stats->dips += 1;
+    }
+}
+
+void solver_t::_extract_inputs(std::vector<bool>& input_values)
+{
+    using namespace sat_n;
+
+    for(unsigned i=0; i != dbl.dbl->num_ckt_inputs(); i++) {
+        int jdx  = dbl.dbl->ckt_inputs[i]->get_index();
+        lbool val = S.modelValue(lmap[jdx]);
+        assert(val.isDef());
+        input_values[i] = val.getBool();
+    }
+}
+
+// Each DIP found is excluded by a clause over the ckt inputs, guarded by a
+// fresh activation literal. The literal is only assumed for these solves and
+// disabled at the end, so the blocking clauses don't remove any patterns in
+// the later iterations.
+void solver_t::_find_more_dips(iter_stats_t& stats)
+{
+    using namespace sat_n;
+
+    Lit act = mkLit(S.newVar());
+    S.freeze(act);
+
+    vec_lit_t assumps;
+    assumps.push(l_out);
+    assumps.push(act);
+
+    std::vector<bool> inputs(input_values.size());
+    while((int) batch_inputs.size() < dip_batch) {
+        const std::vector<bool>& last = batch_inputs.back();
+        vec_lit_t block;
+        block.push(~act);
+        for(unsigned i=0; i != cktinput_literals.size(); i++) {
+            block.push(last[i] ? ~cktinput_literals[i] : cktinput_literals[i]);
+        }
+        S.addClause(block);
+
+        auto t0 = std::chrono::steady_clock::now();
+        bool result = S.solve(assumps);
+        stats.solve_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        if(!result) {
+            break;
+        }
+        _extract_inputs(inputs);
+        batch_inputs.push_back(inputs);
+    }
+    S.addClause(~act);
+}
+
+// Finds the sample keys eliminated by each pattern, i.e., those for which the
+// locked circuit disagrees with the oracle output. The patterns are packed
+// into the lanes of tsim, and each batch of lanes is simulated once per key.
+void solver_t::_eliminated_keys(
+    const std::vector<std::vector<bool> >& inputs,
+    const std::vector<std::vector<bool> >& outputs,
+    const std::vector<std::vector<bool> >& keys,
+    std::vector<uint64_t>& elim)
+{
+    using namespace ckt_n;
+    typedef bitsim_t::word_t word_t;
+
+    const unsigned num_patterns = inputs.size();
+    const unsigned key_words = (keys.size() + bitsim_t::WORD_BITS - 1) / bitsim_t::WORD_BITS;
+    const unsigned words = bitsim_t::DEFAULT_WORDS;
+    const unsigned lanes = words * bitsim_t::WORD_BITS;
+
+    elim.assign(num_patterns * key_words, 0);
+    const int batches = (num_patterns + lanes - 1) / lanes;
+    #pragma omp parallel
+    {
+        bitsim_t::frame_t f;
+        tsim.init_frame(f, words);
+        rng_t rng;
+        std::vector<word_t> expected(ckt.num_outputs() * words);
+
+        #pragma omp for schedule(dynamic)
+        for(int b = 0; b < batches; b++) {
+            unsigned p0 = b * lanes;
+            unsigned n = std::min(lanes, num_patterns - p0);
+
+            std::fill(expected.begin(), expected.end(), 0);
+            for(unsigned l=0; l != n; l++) {
+                for(unsigned i=0; i != ckt.num_ckt_inputs(); i++) {
+                    tsim.set_value(f, ckt.ckt_inputs[i]->get_index(), l, inputs[p0+l][i]);
+                }
+                for(unsigned o=0; o != ckt.num_outputs(); o++) {
+                    if(outputs[p0+l][o]) {
+                        expected[o*words + l/bitsim_t::WORD_BITS] |= (word_t)1 << (l % bitsim_t::WORD_BITS);
+                    }
+                }
+            }
+
+            for(unsigned k=0; k != keys.size(); k++) {
+                for(unsigned i=0; i != ckt.num_key_inputs(); i++) {
+                    tsim.set_value(f, ckt.key_inputs[i]->get_index(), keys[k][i]);
+                }
+                tsim.eval(f, rng);
+
+                for(unsigned w=0; w*bitsim_t::WORD_BITS < n; w++) {
+                    word_t diff = 0;
+                    for(unsigned o=0; o != ckt.num_outputs(); o++) {
+                        diff |= tsim.get_words(f, tsim.outputs[o])[w] ^ expected[o*words + w];
+                    }
+                    if(n - w*bitsim_t::WORD_BITS < bitsim_t::WORD_BITS) {
+                        diff &= ((word_t)1 << (n - w*bitsim_t::WORD_BITS)) - 1;
+                    }
+                    while(diff) {
+                        unsigned p = p0 + w*bitsim_t::WORD_BITS + __builtin_ctzll(diff);
+                        elim[p*key_words + k/bitsim_t::WORD_BITS] |= (word_t)1 << (k % bitsim_t::WORD_BITS);
+                        diff &= diff - 1;
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Random keys are eliminated by almost any pattern, so the sample is drawn
+// around a key which is consistent with the patterns recorded so far: that
+// key itself and copies of it with a few bits flipped. The patterns are then
+// picked greedily, each eliminating the most sampled keys not eliminated by
+// the ones picked before. This is repeated with a new consistent key until
+// none of the patterns refutes that key; the DIP loop takes over from there.
+void solver_t::_warm_start(iter_stats_t& stats)
+{
+    using namespace sat_n;
+    using namespace ckt_n;
+    typedef bitsim_t::word_t word_t;
+
+    const unsigned num_patterns = warm_patterns;
+    const unsigned key_words = 4;
+    const unsigned num_keys = key_words * bitsim_t::WORD_BITS;
+
+    std::vector<std::vector<bool> > inputs(num_patterns, std::vector<bool>(ckt.num_ckt_inputs()));
+    for(unsigned p=0; p != num_patterns; p++) {
+        for(unsigned i=0; i != inputs[p].size(); i++) {
+            inputs[p][i] = bool(rand() % 2);
+        }
+    }
+
+    // one observation per pattern is enough for the ranking, so the oracle
+    // isn't sampled here.
+    std::vector<std::vector<bool> > outputs;
+    auto t0 = std::chrono::steady_clock::now();
+    bool sampling = simckt.IO_sampling_flag;
+    simckt.IO_sampling_flag = false;
+    sim.eval(inputs, outputs);
+    simckt.IO_sampling_flag = sampling;
+    stats.oracle_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    stats.samples += num_patterns;
+
+    std::vector<std::vector<bool> > keys(num_keys, std::vector<bool>(ckt.num_key_inputs()));
+    std::vector<word_t> elim;
+    std::vector<bool> taken(num_patterns, false);
+    std::vector<unsigned> key_index(ckt.num_key_inputs());
+    for(unsigned i=0; i != key_index.size(); i++) {
+        key_index[i] = i;
+    }
+    unsigned added = 0, rounds = 0;
+    while(added != num_patterns) {
+        auto t1 = std::chrono::steady_clock::now();
+        bool result = S.solve();
+        stats.solve_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - t1).count();
+        if(!result) {
+            break;
+        }
+        for(unsigned i=0; i != ckt.num_key_inputs(); i++) {
+            keys[0][i] = S.modelValue(keyinput_literals_A[i]).getBool();
+        }
+        // the flipped bits are distinct, drawn by a partial Fisher-Yates
+        // shuffle of the key indices.
+        for(unsigned k=1; k != num_keys; k++) {
+            keys[k] = keys[0];
+            unsigned flips = std::min<unsigned>(k % 4 + 1, key_index.size());
+            for(unsigned j=0; j != flips; j++) {
+                std::swap(key_index[j], key_index[j + rand() % (key_index.size() - j)]);
+                unsigned i = key_index[j];
+                keys[k][i] = !keys[k][i];
+            }
+        }
+        _eliminated_keys(inputs, outputs, keys, elim);
+
+        // stop once none of the patterns refutes the consistent key.
+        bool refuted = false;
+        for(unsigned p=0; p != num_patterns && !refuted; p++) {
+            refuted = !taken[p] && (elim[p*key_words] & 1);
+        }
+        if(!refuted) {
+            break;
+        }
+
+        std::vector<word_t> covered(key_words, 0);
+        batch_inputs.clear();
+        batch_outputs.clear();
+        while(true) {
+            int best = -1;
+            unsigned best_gain = 0;
+            for(unsigned p=0; p != num_patterns; p++) {
+                if(taken[p]) continue;
+                unsigned gain = 0;
+                for(unsigned w=0; w != key_words; w++) {
+                    gain += __builtin_popcountll(elim[p*key_words + w] & ~covered[w]);
+                }
+                if(gain > best_gain) {
+                    best = p;
+                    best_gain = gain;
+                }
+            }
+            if(best == -1) {
+                break;
+            }
+            taken[best] = true;
+            for(unsigned w=0; w != key_words; w++) {
+                covered[w] |= elim[best*key_words + w];
+            }
+            batch_inputs.push_back(inputs[best]);
+            batch_outputs.push_back(outputs[best]);
+        }
+        if(batch_inputs.size() == 0) {
+            break;
+        }
+
+        // the constraints use sampled observations, like the DIPs.
+        if(sampling) {
+            uint64_t samples = sim.total_samples;
+            auto t2 = std::chrono::steady_clock::now();
+            sim.eval(batch_inputs, batch_outputs);
+            stats.oracle_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - t2).count();
+            stats.samples += sim.total_samples - samples;
+        }
+        for(unsigned p=0; p != batch_inputs.size(); p++) {
+            _record_io_values(batch_inputs[p], batch_outputs[p], &stats);
+        }
+        added += batch_inputs.size();
+        rounds++;
+    }
+
+    std::cout << "warm start: added " << added << " of " << num_patterns
+              << " random patterns in " << rounds << " rounds." << std::endl;
 }
 
 bool solver_t::_solve_v0(rmap_t& keysFound, bool quiet, int dlimFactor)
@@ -178,21 +665,60 @@ bool solver_t::_solve_v0(rmap_t& keysFound, bool quiet, int dlimFactor)
     using namespace ckt_n;
     using namespace AllSAT;
 
-    // add all zeros.
-    for(unsigned i=0; i != dbl.dbl->num_ckt_inputs(); i++) { 
-        input_values[i]=false; 
-    }
-    _record_input_values();
+    iter_stats_t init_stats(0);
+    auto loop_start = std::chrono::steady_clock::now();
+    last_checkpoint = loop_start;
+
+    // the first iteration at which the approximate key was good enough,
+    // and the time it took to get there.
+    rmap_t approxKeys;
+    int approx_iter = -1;
+    double approx_time = 0;
 
-    // and all ones.
-    for(unsigned i=0; i != dbl.dbl->num_ckt_inputs(); i++) { 
-        input_values[i]=true; 
+    if(resume_vectors.size()) {
+        // the patterns of the checkpoint already include the initial ones.
+        for(unsigned i=0; i != resume_vectors.size(); i++) {
+            _record_io_values(resume_vectors[i].inputs, resume_vectors[i].outputs, &init_stats);
+        }
+        std::cout << "resumed after iteration " << iter << " with " 
+                  << resume_vectors.size() << " recorded patterns." << std::endl;
+        resume_vectors.clear();
+    } else {
+        // add all zeros.
+        for(unsigned i=0; i != dbl.dbl->num_ckt_inputs(); i++) { 
+            input_values[i]=false; 
+        }
+        _record_input_values(&init_stats);
+
+        // and all ones.
+        for(unsigned i=0; i != dbl.dbl->num_ckt_inputs(); i++) { 
+            input_values[i]=true; 
+        }
+        _record_input_values(&init_stats);
+
+        if(warm_patterns > 0) {
+            _warm_start(init_stats);
+        }
     }
-    _record_input_values();
+
+    init_stats.vars = S.nVars();
+    init_stats.clauses = S.nClauses();
+    iter_stats.push_back(init_stats);
 
     bool done = false;
     while(true) {
+        iter_stats_t stats(iter + 1);
+        int64_t decisions = S.getNumDecisions();
+        int64_t conflicts = S.getNumConflicts();
+        int64_t propagations = S.getNumPropagations();
+
+        auto t0 = std::chrono::steady_clock::now();
         bool result = S.solve(l_out);
+        stats.solve_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        stats.decisions = S.getNumDecisions() - decisions;
+        stats.conflicts = S.getNumConflicts() - conflicts;
+        stats.propagations = S.getNumPropagations() - propagations;
+
         if(dlimFactor != -1) {
             int dlim = dlimFactor * S.nVars();
             if(dlim <= S.getNumDecisions()) {
@@ -217,27 +743,77 @@ bool solver_t::_solve_v0(rmap_t& keysFound, bool quiet, int dlimFactor)
                   << "; decisions: " << S.getNumDecisions() << std::endl;
 
         if(false == result) {
+            stats.vars = S.nVars();
+            stats.clauses = S.nClauses();
+            iter_stats.push_back(stats);
             done = true;
             break;
         }
 
+        // the key for the error estimate is the one of this model, so that
+        // the estimates don't add any calls to the solver.
+        bool approx_check = approx_error > 0 && approx_iter == -1 && iter % approx_interval == 0;
+        if(approx_check) {
+            approxKeys.clear();
+            _extractSolution(approxKeys);
+        }
+
         // now extract the inputs.
-        for(unsigned i=0; i != dbl.dbl->num_ckt_inputs(); i++) {
-            int jdx  = dbl.dbl->ckt_inputs[i]->get_index();
-            lbool val = S.modelValue(lmap[jdx]);
-            assert(val.isDef());
-            if(!val.getBool()) {
-                input_values[i] = false;
-            } else {
-                input_values[i] = true;
+        _extract_inputs(input_values);
+        if(dip_batch > 1) {
+            // query the oracle for all the DIPs at once, then add all their
+            // constraints before the next solve.
+            batch_inputs.assign(1, input_values);
+            _find_more_dips(stats);
+
+            uint64_t samples = sim.total_samples;
+            auto t1 = std::chrono::steady_clock::now();
+            sim.eval(batch_inputs, batch_outputs);
+            stats.oracle_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - t1).count();
+            stats.samples += sim.total_samples - samples;
+
+            for(unsigned b=0; b != batch_inputs.size(); b++) {
+                _record_io_values(batch_inputs[b], batch_outputs[b], &stats);
             }
+            input_values = batch_inputs.back();
+            output_values = batch_outputs.back();
+        } else {
+            _record_input_values(&stats);
+        }
+        stats.decisions = S.getNumDecisions() - decisions;
+        stats.conflicts = S.getNumConflicts() - conflicts;
+        stats.propagations = S.getNumPropagations() - propagations;
+        stats.vars = S.nVars();
+        stats.clauses = S.nClauses();
+        iter_stats.push_back(stats);
+        if(dip_batch > 1) {
+            std::cout << " DIPs in this iteration: " << stats.dips << std::endl;
+        }
+        if(simckt.IO_sampling_flag) {
+            std::cout << " samples drawn: " << stats.samples << std::endl;
         }
-        _record_input_values();
         if(verbose) {
             std::cout << "input: " << input_values 
                 << "; output: " << output_values << std::endl;
         }
 
+        _checkpoint(false);
+
+        if(approx_check) {
+            double error, bound;
+            _estimate_error(approxKeys, error, bound);
+            std::cout << " estimated error of the current key: " << error 
+                      << " \% (upper bound: " << bound << " \%)" << std::endl;
+            if(bound < approx_error) {
+                approx_iter = iter;
+                approx_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - loop_start).count();
+                if(!approx_compare) {
+                    done = true;
+                    break;
+                }
+            }
+        }
+
         // _sanity_check_model();
 
         struct rusage ru_current;
@@ -247,9 +823,27 @@ bool solver_t::_solve_v0(rmap_t& keysFound, bool quiet, int dlimFactor)
             break;
         }
     }
+    _checkpoint(true);
     if(done) {
         std::cout << "finished solver loop." << std::endl;
-        _verify_solution_sim(keysFound);
+        if(simckt.IO_sampling_flag) {
+            std::cout << "samples drawn in total: " << sim.total_samples << std::endl;
+        }
+        double loop_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - loop_start).count();
+        if(approx_iter != -1 && !approx_compare) {
+            std::cout << "approximate termination after iteration " << approx_iter 
+                      << " (" << approx_time << " s)." << std::endl;
+            keysFound = approxKeys;
+            _verify_solution_sim(keysFound, false);
+        } else {
+            _verify_solution_sim(keysFound);
+        }
+        if(approx_iter != -1 && approx_compare) {
+            std::cout << "approximate termination after iteration " << approx_iter 
+                      << " (" << approx_time << " s) would have saved " << loop_time - approx_time 
+                      << " s and " << iter - approx_iter << " iterations of the exact loop (" 
+                      << loop_time << " s)." << std::endl;
+        }
     }
     return done;
 #if 0
@@ -257,6 +851,53 @@ bool solver_t::_solve_v0(rmap_t& keysFound, bool quiet, int dlimFactor)
 #endif
 }
 
+void solver_t::dumpIterStats(std::ostream& out, bool json) const
+{
+    if(json) {
+        out << "[" << std::endl;
+    } else {
+        out << "iter,vars,clauses,solve_time,oracle_time,rewrite_time,clauses_added,samples,decisions,conflicts,propagations,dips" << std::endl;
+    }
+
+    // backends which don't count conflicts and propagations get an empty
+    // field, or null, rather than a count of 0.
+    bool search_stats = S.hasSearchStats();
+    for(unsigned i=0; i != iter_stats.size(); i++) {
+        const iter_stats_t& st = iter_stats[i];
+        std::string conflicts = json ? "null" : "";
+        std::string propagations = conflicts;
+        if(search_stats) {
+            conflicts = boost::lexical_cast<std::string>(st.conflicts);
+            propagations = boost::lexical_cast<std::string>(st.propagations);
+        }
+        if(json) {
+            out << "  {\"iter\": " << st.iter
+                << ", \"vars\": " << st.vars
+                << ", \"clauses\": " << st.clauses
+                << ", \"solve_time\": " << st.solve_time
+                << ", \"oracle_time\": " << st.oracle_time
+                << ", \"rewrite_time\": " << st.rewrite_time
+                << ", \"clauses_added\": " << st.clauses_added
+                << ", \"samples\": " << st.samples
+                << ", \"decisions\": " << st.decisions
+                << ", \"conflicts\": " << conflicts
+                << ", \"propagations\": " << propagations
+                << ", \"dips\": " << st.dips
+                << "}" << (i + 1 != iter_stats.size() ? "," : "") << std::endl;
+        } else {
+            out << st.iter << "," << st.vars << "," << st.clauses << ","
+                << st.solve_time << "," << st.oracle_time << "," << st.rewrite_time << ","
+                << st.clauses_added << "," << st.samples << ","
+                << st.decisions << "," << conflicts << "," << propagations << ","
+                << st.dips << std::endl;
+        }
+    }
+
+    if(json) {
+        out << "]" << std::endl;
+    }
+}
+
 void solver_t::_sanity_check_model()
 {
     using namespace sat_n;
@@ -333,7 +974,7 @@ bool solver_t::getNewKey(rmap_t& keysFound)
     return _verify_solution_sim(keysFound);
 }
 
-bool solver_t::_verify_solution_sim(rmap_t& keysFound)
+bool solver_t::_verify_solution_sim(rmap_t& keysFound, bool solve)
 {
     using namespace sat_n;
     using namespace ckt_n;
@@ -343,7 +984,6 @@ bool solver_t::_verify_solution_sim(rmap_t& keysFound)
     std::unordered_set<std::vector<bool>> patterns;
     int successful_iter = 0;
     int steps = 1;
-    bool key_extracted = false;
     double test_coverage;
     double HD = 0.0;
 
@@ -371,88 +1011,84 @@ bool solver_t::_verify_solution_sim(rmap_t& keysFound)
 	    std::cout << " Sampling and selection of output patterns is on" << std::endl;
     }
 
-    for(int iter=0; iter < MAX_VERIF_ITER;  iter++) {
-        vec_lit_t assumps;
-        std::vector<bool> input_values;
-        std::vector<bool> output_values;
+    // any key which is consistent with all the DIPs will do; the key is extracted once and then applied as constants to the locked circuit, which is
+    // simulated against the oracle, instead of solving the doubled circuit for each test pattern
+    if(solve) {
+        if(S.solve() == false) {
+            std::cout << "UNSAT model!" << std::endl;
+            return false;
+        }
+        _extractSolution(keysFound);
+    }
+
+    ckt_eval_t keysim(ckt, ckt.ckt_inputs);
+    for(unsigned i=0; i != ckt.num_key_inputs(); i++) {
+        keysim.set_cnst(ckt.key_inputs[i], keysFound[ckt.key_inputs[i]->name]);
+    }
+
+    std::vector<std::vector<bool>> batch_inputs;
+    std::vector<std::vector<bool>> batch_outputs;
+    std::vector<std::vector<bool>> batch_key_outputs;
+    unsigned long steps_size = std::max(1ul, MAX_VERIF_ITER / 20);
+
+    for(unsigned long iter=0; iter < MAX_VERIF_ITER;  iter++) {
 
 	// JOHANN
 	//
 	bool pass = true;
 
-	// generate random test pattern
-	do {
-		input_values.clear();
-
-		for(unsigned i=0; i != cktinput_literals.size(); i++) {
-		    bool vi = bool(rand() % 2);
-	//            assumps.push( vi ? cktinput_literals[i] : ~cktinput_literals[i]);
-		    input_values.push_back(vi);
+	// the oracle and the locked circuit are evaluated for a batch of patterns at once, which are packed into the lanes of the simulators
+	unsigned batch_idx = iter % sim.lanes();
+	if (batch_idx == 0) {
+		unsigned batch_size = std::min<unsigned long>(sim.lanes(), MAX_VERIF_ITER - iter);
+		batch_inputs.resize(batch_size);
+
+		for (unsigned b = 0; b != batch_size; b++) {
+			std::vector<bool>& input_values = batch_inputs[b];
+
+			// generate random test pattern
+			do {
+				input_values.clear();
+
+				for(unsigned i=0; i != cktinput_literals.size(); i++) {
+				    bool vi = bool(rand() % 2);
+				    input_values.push_back(vi);
+				}
+			}
+			// if pattern was used before, generate another one
+			while (patterns.count(input_values) == 1);
+
+			// pattern was not used before, so we shall memorize and use it
+			patterns.insert(input_values);
 		}
-	}
-	// if pattern was used before, generate another one
-	while (patterns.count(input_values) == 1);
-
-	// pattern was not used before, so we shall memorize and use it
-	patterns.insert(input_values);
 
-	for(unsigned i=0; i != cktinput_literals.size(); i++) {
-		// modified from original line above
-		assumps.push( input_values[i] ? cktinput_literals[i] : ~cktinput_literals[i]);
+		sim.eval(batch_inputs, batch_outputs);
+		keysim.eval(batch_inputs, batch_key_outputs);
 	}
-
-        sim.eval(input_values, output_values);
+	const std::vector<bool>& input_values = batch_inputs[batch_idx];
+	const std::vector<bool>& output_values = batch_outputs[batch_idx];
+	const std::vector<bool>& key_output_values = batch_key_outputs[batch_idx];
 
         if(verbose) {
             std::cout << "input: " << input_values 
                       << "; output: " << output_values << std::endl;
-            dump_clause(std::cout << "assumps: ", assumps) << std::endl;
-        }
-
-        if(S.solve(assumps) == false) {
-            std::cout << "UNSAT model!" << std::endl;
-            return false;
+            std::cout << "sim output: " << key_output_values << std::endl;
         }
 
-        if(verbose) {
-            dump_clause(std::cout << "sat input: ", assumps) << std::endl;
-            std::cout << "sat output: ";
-        }
         for(unsigned i=0; i != output_values.size(); i++) {
-            bool vi = output_values[i];
-            lbool ri = S.modelValue(output_literals_A[i]);
-            if(verbose) {
-                std::cout << (ri.isUndef() ? "-" : (ri.getBool() ? "1" : "0"));
-            }
-            if(!(ri.isDef() && ri.getBool() == vi)) { 
+            if(key_output_values[i] != output_values[i]) {
                 pass = false;
 	// JOHANN
 	// count all the occurrences where one bit is flipped
 		HD++;
             }
         }
-	// JOHANN
-//        if(iter == 0) {
-	if (pass && !key_extracted) {
-            _extractSolution(keysFound);
-	    key_extracted = true;
-        }
-        if(verbose) std::cout << std::endl;
-        if(!pass) {
-            if(verbose) {
-                dbl.dump_solver_state(std::cout, S, lmap);
-                std::cout << std::endl;
-            }
-	// JOHANN
-//            std::cout << "sim failed." << std::endl;
-//            break;
-        }
-	else {
+        if(pass) {
 		successful_iter++;
 	}
 
 	// JOHANN
-	    if ((iter + 1) % (MAX_VERIF_ITER / 20) == 0) {
+	    if ((iter + 1) % steps_size == 0) {
 		    std::cout << steps * 5 << " \% done ..." << std::endl;
 		    steps++;
 	    }
@@ -460,7 +1096,7 @@ bool solver_t::_verify_solution_sim(rmap_t& keysFound)
 
 	// JOHANN
 	test_coverage = 100.0 * static_cast<double>(successful_iter) / static_cast<double>(MAX_VERIF_ITER);
-	HD /= static_cast<double>(MAX_VERIF_ITER * output_values.size());
+	HD /= static_cast<double>(MAX_VERIF_ITER * simckt.num_outputs());
 	HD *= 100.0;
 
     std::cout << "Test coverage rate: " << test_coverage << " \%" << std::endl;
@@ -477,6 +1113,58 @@ bool solver_t::_verify_solution_sim(rmap_t& keysFound)
 	return true;
 }
 
+// Same comparison against the oracle as in _verify_solution_sim, on fewer
+// patterns and without the progress output. The bound is the upper end of
+// the one-sided 95% Wilson score interval of the error rate. The patterns
+// come from approx_rng and the oracle is a separate simulator, so the
+// estimates don't change the patterns and samples drawn by the DIP loop.
+void solver_t::_estimate_error(rmap_t& keys, double& error, double& bound)
+{
+    using namespace ckt_n;
+
+    if(approx_sim == NULL) {
+        uint64_t seed = rnd_seed ? rnd_seed + 1 : time_seed();
+        approx_sim = new ckt_eval_t(simckt, simckt.ckt_inputs);
+        approx_sim->seed(seed);
+        approx_rng.seed_with(seed);
+    }
+
+    ckt_eval_t keysim(ckt, ckt.ckt_inputs);
+    for(unsigned i=0; i != ckt.num_key_inputs(); i++) {
+        keysim.set_cnst(ckt.key_inputs[i], keys[ckt.key_inputs[i]->name]);
+    }
+
+    const unsigned n = APPROX_PATTERNS;
+    std::vector<std::vector<bool> > inputs(n, std::vector<bool>(ckt.num_ckt_inputs()));
+    for(unsigned p=0; p != n; p++) {
+        for(unsigned i=0; i != inputs[p].size(); i++) {
+            inputs[p][i] = approx_rng.next() & 1;
+        }
+    }
+
+    std::vector<std::vector<bool> > outputs, key_outputs;
+    bool sampling = simckt.IO_sampling_flag;
+    simckt.IO_sampling_flag = simckt.IO_sampling_for_test_flag;
+    approx_sim->eval(inputs, outputs);
+    simckt.IO_sampling_flag = sampling;
+    keysim.eval(inputs, key_outputs);
+
+    unsigned fails = 0;
+    for(unsigned p=0; p != n; p++) {
+        if(outputs[p] != key_outputs[p]) {
+            fails++;
+        }
+    }
+
+    const double z = 1.645;
+    double rate = double(fails) / n;
+    double denom = 1 + z*z/n;
+    double center = (rate + z*z/(2*n)) / denom;
+    double half = z * std::sqrt(rate*(1-rate)/n + z*z/(4.0*n*n)) / denom;
+    error = 100.0 * rate;
+    bound = 100.0 * std::min(1.0, center + half);
+}
+
 void solver_t::_extractSolution(rmap_t& keysFound)
 {
     using namespace sat_n;
@@ -596,7 +1284,7 @@ int solver_t::sliceAndSolve( rmap_t& keysFoundMap, int maxKeys, int maxNodes )
     ckt.check_sanity();
     for(unsigned i=0; i != ckt.num_outputs(); i++) {
         std::vector<bool> fanin(ckt.num_nodes());
-        ckt.compute_transitive_fanin(ckt.outputs[i], fanin);
+        ckt.flat.compute_transitive_fanin(ckt.flat.outputs[i], fanin);
 
         for(int j=0; j != (int)fanin.size(); j++) {
             if(fanin[j]) {
@@ -813,7 +1501,7 @@ void solver_t::sliceAndDice(
     // oi => nj <=> -oi + nj >= 0
     for(unsigned i=0; i != ckt.num_outputs(); i++) {
         std::vector<bool> fanin(ckt.num_nodes());
-        ckt.compute_transitive_fanin(ckt.outputs[i], fanin);
+        ckt.flat.compute_transitive_fanin(ckt.flat.outputs[i], fanin);
 
         for(int j=0; j != (int)fanin.size(); j++) {
             if(fanin[j]) {
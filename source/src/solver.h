@@ -112,11 +112,60 @@ public:
     };
     typedef std::vector<iovalue_t> iovalue_vector_t;
 
+    // the patterns recorded by an attack and the oracle outputs for them,
+    // from which the attack can be resumed without querying the oracle.
+    struct checkpoint_t {
+        unsigned num_inputs;
+        unsigned num_outputs;
+        unsigned num_keys;
+        int iterations;
+        // the -k string the attack was started with.
+        std::string known_keys;
+        iovalue_vector_t iovectors;
+
+        checkpoint_t()
+            : num_inputs(0), num_outputs(0), num_keys(0), iterations(0)
+        {}
+
+        // returns false, after printing a message, if the file can't be
+        // read or is corrupt.
+        bool read(const std::string& file);
+    };
+
+    // statistics for one iteration of the DIP loop; iteration 0 covers the
+    // initial all-zeros and all-ones patterns. times are wall-clock seconds,
+    // the solver counters are the increments during the iteration. dips is
+    // the number of patterns recorded in the iteration.
+    struct iter_stats_t {
+        int iter;
+        int dips;
+        int vars;
+        int clauses;
+        double solve_time;
+        double oracle_time;
+        double rewrite_time;
+        int clauses_added;
+        unsigned samples;
+        int64_t decisions;
+        int64_t conflicts;
+        int64_t propagations;
+
+        iter_stats_t(int i) 
+            : iter(i), dips(0), vars(0), clauses(0)
+            , solve_time(0), oracle_time(0), rewrite_time(0)
+            , clauses_added(0), samples(0)
+            , decisions(0), conflicts(0), propagations(0)
+        {}
+    };
+
 private:
     ckt_n::ckt_t& ckt;
     ckt_n::ckt_t& simckt;
     ckt_n::ckt_eval_t sim;
     ckt_n::dblckt_t dbl;
+    // three-valued simulator for the locked circuit, keys are unknown.
+    ckt_n::bitsim_t tsim;
+    ckt_n::bitsim_t::frame_t tsim_val, tsim_known;
 
     unsigned long MAX_VERIF_ITER;
     sat_n::Solver S;              // "doubled-ckt" solver.
@@ -136,22 +185,68 @@ private:
 
     std::vector<bool> input_values;
     std::vector<bool> output_values;
+    std::vector<sat_n::lbool> record_values;
+    // the DIPs of the current iteration and their oracle outputs.
+    std::vector<std::vector<bool> > batch_inputs, batch_outputs;
     std::vector<bool> fixed_keys;
     iovalue_vector_t iovectors;
+    // patterns to replay instead of the initial ones, set by resume().
+    iovalue_vector_t resume_vectors;
+    std::chrono::steady_clock::time_point last_checkpoint;
+    // oracle and random patterns of the error estimates, created on the
+    // first estimate.
+    ckt_n::ckt_eval_t* approx_sim;
+    ckt_n::rng_t approx_rng;
 
     // methods.
     void _sanity_check_model();
-    bool _verify_solution_sim(std::map< std::string, int >& keysFound);
+    // verifies the key found by solving S, or the one in keysFound if solve
+    // is false.
+    bool _verify_solution_sim(std::map< std::string, int >& keysFound, bool solve = true);
+    // estimates the output error rate of the keys, in percent, on
+    // APPROX_PATTERNS random patterns.
+    void _estimate_error(rmap_t& keys, double& error, double& bound);
+    static const unsigned APPROX_PATTERNS = 1024;
     bool _verify_solution_sat();
 
     // Evaluates the output for the values stored in input_values and then
     // records this in the solver.
-    void _record_input_values();
+    // If stats is given, the oracle and rewriting times are added to it.
+    void _record_input_values(iter_stats_t* stats = NULL);
+    // records the output values observed for the input values.
+    void _record_io_values(
+        const std::vector<bool>& input_values, 
+        const std::vector<bool>& output_values, 
+        iter_stats_t* stats
+    );
+    // reads the ckt inputs of the model into input_values.
+    void _extract_inputs(std::vector<bool>& input_values);
+    // after a DIP has been found, looks for up to dip_batch-1 more DIPs
+    // which differ from it and from each other; all of them are put in
+    // batch_inputs.
+    void _find_more_dips(iter_stats_t& stats);
+    // simulates warm_patterns random patterns on the oracle and records the
+    // ones which eliminate the most keys from a sample of keys.
+    void _warm_start(iter_stats_t& stats);
+    // writes a checkpoint if one is due, or always if force is set.
+    void _checkpoint(bool force);
+    // bit k of elim[p*w .. (p+1)*w), w = (keys.size()+63)/64, is set if
+    // pattern p with the oracle output eliminates keys[k].
+    void _eliminated_keys(
+        const std::vector<std::vector<bool> >& inputs,
+        const std::vector<std::vector<bool> >& outputs,
+        const std::vector<std::vector<bool> >& keys,
+        std::vector<uint64_t>& elim);
     void _record_sim(
         const std::vector<bool>& input_values, 
         const std::vector<bool>& output_values, 
         std::vector<sat_n::lbool>& values
     );
+    // assigns the gates whose values don't depend on the keys.
+    void _propagate_constants(
+        const std::vector<bool>& input_values, 
+        std::vector<sat_n::lbool>& values
+    );
 
     bool _solve_v0(rmap_t& keysFound, bool quiet, int dlimFactor);
     void _testBackbones(
@@ -168,6 +263,13 @@ public:
     volatile int iter;
     volatile int backbones_count;
     volatile int cube_count;
+    std::vector<iter_stats_t> iter_stats;
+    // checkpoints are written to checkpoint_file (if not empty) after an
+    // iteration if checkpoint_interval seconds have passed since the last
+    // one, and when the DIP loop ends. known_keys is stored in them.
+    std::string checkpoint_file;
+    double checkpoint_interval;
+    std::string known_keys;
 
 
     solver_t(ckt_n::ckt_t& ckt, ckt_n::ckt_t& sim, int verbose);
@@ -181,10 +283,16 @@ public:
     );
 
     void addKnownKeys(std::vector<std::pair<int, int> >& values);
+    // continue the attack of a checkpoint; exits if it doesn't fit the
+    // circuit.
+    void resume(const checkpoint_t& cp);
+    bool writeCheckpoint(const std::string& file) const;
     bool solve(solver_version_t ver, rmap_t& keysFoundMap, bool quiet);
     void blockKey(rmap_t& keysFoundMap);
     bool getNewKey(rmap_t& keysFoundMap);
     void findFixedKeys(std::map<int, int>& backbones);
+    // write iter_stats as CSV, or as JSON.
+    void dumpIterStats(std::ostream& out, bool json) const;
 
     static void solveSlice(
         slice_t& slice, 
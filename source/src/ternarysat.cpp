@@ -1,3 +1,4 @@
+#include "node.h"
 #include "ternarysat.h"
 
 namespace ckt_n
@@ -14,7 +14,7 @@ namespace ckt_n {
     template<class Solver>
     void add_ternary_triop_clauses(
         Solver& S,
-        node2var_map_t& map,
+        const index2var_map_t& map,
         nodelist_t& inputs,
         node_t* output,
         void (*add_clauses)(Solver& S, sat_n::vec_lit_t& xs, sat_n::vec_lit_t& ys)
@@ -22,19 +22,15 @@ namespace ckt_n {
     {
         using namespace sat_n;
         assert(inputs.size() == 3);
-        assert(map.find(inputs[0]) != map.end());
-        assert(map.find(inputs[1]) != map.end());
-        assert(map.find(inputs[2]) != map.end());
-        Lit a0 = mkLit(map[inputs[0]]);
-        Lit a1 = mkLit(map[inputs[0]] + 1);
-        Lit b0 = mkLit(map[inputs[1]]);
-        Lit b1 = mkLit(map[inputs[1]] + 1);
-        Lit c0 = mkLit(map[inputs[2]]);
-        Lit c1 = mkLit(map[inputs[2]] + 1);
-
-        assert(map.find(output) != map.end());
-        Lit y0 = mkLit(map[output]);
-        Lit y1 = mkLit(map[output] + 1);
+        Lit a0 = mkLit(node_var(map, inputs[0]));
+        Lit a1 = mkLit(node_var(map, inputs[0]) + 1);
+        Lit b0 = mkLit(node_var(map, inputs[1]));
+        Lit b1 = mkLit(node_var(map, inputs[1]) + 1);
+        Lit c0 = mkLit(node_var(map, inputs[2]));
+        Lit c1 = mkLit(node_var(map, inputs[2]) + 1);
+
+        Lit y0 = mkLit(node_var(map, output));
+        Lit y1 = mkLit(node_var(map, output) + 1);
 
         vec_lit_t xs;
         xs.push(a0); xs.push(a1);
@@ -50,7 +46,7 @@ namespace ckt_n {
     template<class Solver>
     void add_ternary_binop_clauses(
         Solver& S,
-        node2var_map_t& map,
+        const index2var_map_t& map,
         nodelist_t& inputs,
         node_t* output,
         void (*add_clauses)(Solver& S, sat_n::vec_lit_t& xs, sat_n::vec_lit_t& ys)
@@ -58,16 +54,13 @@ namespace ckt_n {
     {
         using namespace sat_n;
         assert(inputs.size() == 2);
-        assert(map.find(inputs[0]) != map.end());
-        assert(map.find(inputs[1]) != map.end());
-        Lit a0 = mkLit(map[inputs[0]]);
-        Lit a1 = mkLit(map[inputs[0]] + 1);
-        Lit b0 = mkLit(map[inputs[1]]);
-        Lit b1 = mkLit(map[inputs[1]] + 1);
+        Lit a0 = mkLit(node_var(map, inputs[0]));
+        Lit a1 = mkLit(node_var(map, inputs[0]) + 1);
+        Lit b0 = mkLit(node_var(map, inputs[1]));
+        Lit b1 = mkLit(node_var(map, inputs[1]) + 1);
 
-        assert(map.find(output) != map.end());
-        Lit y0 = mkLit(map[output]);
-        Lit y1 = mkLit(map[output] + 1);
+        Lit y0 = mkLit(node_var(map, output));
+        Lit y1 = mkLit(node_var(map, output) + 1);
 
         vec_lit_t xs;
         xs.push(a0); xs.push(a1);
@@ -82,7 +75,7 @@ namespace ckt_n {
     template<class Solver>
     void add_ternary_unop_clauses(
         Solver& S,
-        node2var_map_t& map,
+        const index2var_map_t& map,
         nodelist_t& inputs,
         node_t* output,
         void (*add_clauses)(Solver& S, sat_n::vec_lit_t& xs, sat_n::vec_lit_t& ys)
@@ -90,13 +83,11 @@ namespace ckt_n {
     {
         using namespace sat_n;
         assert(inputs.size() == 1);
-        assert(map.find(inputs[0]) != map.end());
-        Lit a0 = mkLit(map[inputs[0]]);
-        Lit a1 = mkLit(map[inputs[0]] + 1);
+        Lit a0 = mkLit(node_var(map, inputs[0]));
+        Lit a1 = mkLit(node_var(map, inputs[0]) + 1);
 
-        assert(map.find(output) != map.end());
-        Lit y0 = mkLit(map[output]);
-        Lit y1 = mkLit(map[output] + 1);
+        Lit y0 = mkLit(node_var(map, output));
+        Lit y1 = mkLit(node_var(map, output) + 1);
 
         vec_lit_t xs;
         xs.push(a0); xs.push(a1);
@@ -117,7 +108,7 @@ namespace ckt_n {
 
         virtual void add_clauses(
             Solver& S, 
-            node2var_map_t& map, 
+            const index2var_map_t& map, 
             nodelist_t& inputs, 
             node_t* output
         ) const
@@ -136,7 +127,7 @@ namespace ckt_n {
 
         virtual void add_clauses(
             Solver& S, 
-            node2var_map_t& map, 
+            const index2var_map_t& map, 
             nodelist_t& inputs, 
             node_t* output
         ) const
@@ -155,7 +146,7 @@ namespace ckt_n {
 
         virtual void add_clauses(
             Solver& S, 
-            node2var_map_t& map, 
+            const index2var_map_t& map, 
             nodelist_t& inputs, 
             node_t* output
         ) const
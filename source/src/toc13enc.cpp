@@ -40,10 +40,24 @@ namespace ckt_n
 
     void toc13enc_t::evaluateFaultImpact(int nSims)
     {
-        _evaluateRandomVectors(nSims);
-        faultMetrics.resize(ckt.num_nodes());
-        for(unsigned i=0; i != ckt.num_nodes(); i++) {
-            faultMetrics[i] = _evaluateFaultImpact(ckt.nodes[i]);
+        assert(nSims > 0);
+
+        // all random vectors are simulated at once, one per lane.
+        bitsim_t bsim(ckt);
+        bitsim_t::frame_t good;
+        bsim.init_frame(good, (nSims + bitsim_t::WORD_BITS - 1) / bitsim_t::WORD_BITS);
+        _evaluateRandomVectors(bsim, good, nSims);
+
+        int n = ckt.num_nodes();
+        faultMetrics.resize(n);
+        #pragma omp parallel
+        {
+            bitsim_t::fault_frame_t ff;
+            bsim.init_fault_frame(ff, good);
+            #pragma omp for schedule(dynamic, 16)
+            for(int i=0; i < n; i++) {
+                faultMetrics[i] = _evaluateFaultImpact(bsim, good, ff, ckt.nodes[i], nSims);
+            }
         }
     }
 
@@ -252,106 +266,34 @@ namespace ckt_n
         out << ckt << std::endl;
     }
 
-    void toc13enc_t::_evaluateRandomVectors(int nSims)
+    void toc13enc_t::_evaluateRandomVectors(const bitsim_t& bsim, bitsim_t::frame_t& good, int nSims)
     {
-        ckt_eval_t sim(ckt, ckt.ckt_inputs);
-
         assert(ckt.num_key_inputs() == 0);
-        bool_vec_t inputs(ckt.num_ckt_inputs());
-        bool_vec_t outputs(ckt.num_outputs());
+        assert(nSims <= (int) good.lanes());
 
+        // same sequence of random values as one vector at a time.
         for(int i=0; i < nSims; i++) {
-            for(unsigned j=0; j != inputs.size(); j++) {
-                inputs[j] = rand()%2;
+            for(unsigned j=0; j != ckt.num_ckt_inputs(); j++) {
+                bsim.set_value(good, ckt.ckt_inputs[j]->get_index(), i, rand()%2);
             }
-            sim.eval(inputs, outputs);
-            input_sims.push_back(inputs);
-            output_sims.push_back(outputs);
-        }
-    }
-
-    double toc13enc_t::_evaluateFaultImpact(node_t* n)
-    {
-        assert(input_sims.size() == output_sims.size());
-
-        using namespace sat_n;
-
-        Solver S;
-
-        nodeset_t n2ignore;
-        n2ignore.insert(n);
-        index2lit_map_t lmap;
-        ckt.init_solver_ignoring_nodes(S, lmap, n2ignore);
-
-        vec_lit_t assumps(ckt.num_inputs() + 1);
-        bool_vec_t err_outputs(ckt.num_outputs());
-
-        double metric = 0;
-        for(unsigned int i=0; i < input_sims.size(); i++) {
-            bool result;
-
-            _set_assumps(assumps, lmap, input_sims[i], n, 0);
-            result = S.solve(assumps);
-            assert(result);
-            _extract_outputs(S, lmap, err_outputs);
-            metric += _count_differing_outputs(output_sims[i], err_outputs);
-
-            _set_assumps(assumps, lmap, input_sims[i], n, 1);
-            result = S.solve(assumps);
-            assert(result);
-            _extract_outputs(S, lmap, err_outputs);
-            metric += _count_differing_outputs(output_sims[i], err_outputs);
         }
-        return metric / input_sims.size();
+        rng_t rng(0);
+        bsim.eval(good, rng);
     }
 
-    void toc13enc_t::_set_assumps(sat_n::vec_lit_t& assumps,
-        ckt_n::index2lit_map_t& lmap,
-        const bool_vec_t& inputs,
+    // the metric is the average number of outputs that differ from the
+    // fault-free circuit, summed over the stuck-at-0 and stuck-at-1 faults
+    // of the node. in every vector exactly one of the two faults flips the
+    // node and the other one has no effect, so this is the effect of
+    // flipping the node.
+    double toc13enc_t::_evaluateFaultImpact(const bitsim_t& bsim,
+        const bitsim_t::frame_t& good,
+        bitsim_t::fault_frame_t& ff,
         node_t* n,
-        int fault)
+        int nSims)
     {
-        using namespace sat_n;
-        assert(assumps.size() == inputs.size()+1);
-        assert(inputs.size() == ckt.num_ckt_inputs());
-        for(unsigned i=0; i != ckt.num_ckt_inputs(); i++) {
-            Lit li = ckt.getLit(lmap, ckt.ckt_inputs[i]);
-            if(ckt.ckt_inputs[i] != n) {
-                assumps[i] = inputs[i] ? li : ~li;
-            } else {
-                assumps[i] = fault ? li : ~li;
-            }
-        }
-        int last = ckt.num_ckt_inputs();
-        Lit l_node = ckt.getLit(lmap, n);
-        assumps[last] = fault ? l_node : ~l_node;
-    }
-
-    void toc13enc_t::_extract_outputs(
-        sat_n::Solver& S,
-        ckt_n::index2lit_map_t& lmap,
-        bool_vec_t& outputs
-    )
-    {
-        using namespace sat_n;
-
-        assert(outputs.size() == ckt.num_outputs());
-        for(unsigned i=0; i != ckt.num_outputs(); i++) {
-            lbool l_out_i = S.modelValue(ckt.getLit(lmap, ckt.outputs[i]));
-            assert(l_out_i.isDef());
-            outputs[i] = l_out_i.getBool();
-        }
-    }
-    
-    int toc13enc_t::_count_differing_outputs(
-        const bool_vec_t& sim_out, const bool_vec_t& err_out)
-    {
-        int cnt = 0;
-        assert(sim_out.size() == err_out.size());
-        for(unsigned i=0; i != sim_out.size(); i++) {
-            if(sim_out[i] != err_out[i]) cnt += 1;
-        }
-        return cnt;
+        uint64_t metric = bsim.eval_flip(good, ff, n->get_index(), nSims);
+        return (double) metric / nSims;
     }
 }
 
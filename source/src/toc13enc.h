@@ -3,9 +3,10 @@
 
 #include <vector>
 #include "ckt.h"
-#include "ast.h"
+#include "benchfile.h"
 #include "node.h"
 #include "sim.h"
+#include "bitsim.h"
 
 namespace ckt_n
 {
@@ -16,16 +17,14 @@ namespace ckt_n
         ckt_t ckt;
         double fraction;
 
-        std::vector<bool_vec_t> input_sims;
-        std::vector<bool_vec_t> output_sims;
         std::vector<int> onesCount;
         std::vector<double> faultMetrics;
         std::vector<bool> key_values;
 
         std::vector<int> marks;
     public:
-        toc13enc_t(ast_n::statements_t& stms, double fr)
-            : ckt(stms)
+        toc13enc_t(const bench_file_t& bench, double fr)
+            : ckt(bench)
             , fraction(fr)
         {
         }
@@ -41,21 +40,13 @@ namespace ckt_n
         void _convert_node_prob(std::vector<double>& ps, std::map<std::string, double>& pmap);
         double _get_prob(std::map<std::string, double>& pmap, node_t* n);
 
-        void _evaluateRandomVectors(int nSims);
-        double _evaluateFaultImpact(node_t* n);
-        void _set_assumps(sat_n::vec_lit_t& assumps,
-            ckt_n::index2lit_map_t& lmap,
-            const bool_vec_t& inputs,
+        void _evaluateRandomVectors(const bitsim_t& bsim, bitsim_t::frame_t& good, int nSims);
+        double _evaluateFaultImpact(const bitsim_t& bsim,
+            const bitsim_t::frame_t& good,
+            bitsim_t::fault_frame_t& ff,
             node_t* n,
-            int fault);
-        void _extract_outputs(
-            sat_n::Solver& S,
-            ckt_n::index2lit_map_t& lmap,
-            bool_vec_t& outputs
-        );
+            int nSims);
         node_t* _get_best_other(node_t* n1, node_t* kg, std::map<std::string, double>& ps);
-        int _count_differing_outputs(
-            const bool_vec_t& sim_out, const bool_vec_t& err_out);
     };
 }
 
@@ -1,4 +1,5 @@
 #include <iterator>
+#include <algorithm>
 #include "tvsolver.h"
 #include "util.h"
 #include "CEGSolver.h"
@@ -46,6 +47,12 @@ void tv_solver_t::_freeze_nodes()
     S.freeze(l1);
 }
 
+void tv_solver_t::_freeze_node(ckt_n::dblckt_t& dbl_in, ckt_n::index2lit_map_t& lit_map_in, sat_n::Solver& S_in, ckt_n::node_t* n)
+{
+    S_in.freeze(dbl_in.dbl->getTLit0(lit_map_in, n));
+    S_in.freeze(dbl_in.dbl->getTLit1(lit_map_in, n));
+}
+
 void tv_solver_t::_set_node_value(ckt_n::dblckt_t& dbl_in, ckt_n::index2lit_map_t& lit_map_in, ckt_n::node_t* n, int val, sat_n::vec_lit_t& assumps)
 {
     using namespace sat_n;
@@ -317,6 +324,13 @@ bool tv_solver_t::isNonMutable(int i, int j)
     Lit lout0 = dbl.dbl->getTLit0(lit_map, nout);
     Lit lout1 = dbl.dbl->getTLit1(lit_map, nout);
 
+    // the assumptions change between the calls.
+    _freeze_node(dbl, lit_map, S, nout);
+    _freeze_node(dbl, lit_map, S, kiA);
+    _freeze_node(dbl, lit_map, S, kiB);
+    _freeze_node(dbl, lit_map, S, kjA);
+    _freeze_node(dbl, lit_map, S, kjB);
+
     vec_lit_t assumps;
 
     assumps.clear();
@@ -361,6 +375,121 @@ int tv_solver_t::countNonMutablePairs(std::ostream& out)
     return cnt;
 }
 
+// keys i and j share an output if both are in its transitive fanin.
+void tv_solver_t::_keysSharingOutputs(std::vector< std::vector<bool> >& shares_output)
+{
+    using namespace ckt_n;
+
+    std::vector< std::vector<bool> > keymap;
+    ckt.init_keymap(keymap);
+
+    unsigned nkeys = ckt.num_key_inputs();
+    shares_output.assign(nkeys, std::vector<bool>(nkeys, false));
+    std::vector<unsigned> keys;
+    for(unsigned o=0; o != ckt.num_outputs(); o++) {
+        const std::vector<bool>& km = keymap[ckt.outputs[o]->get_index()];
+        keys.clear();
+        for(unsigned i=0; i != nkeys; i++) {
+            if(km[i]) keys.push_back(i);
+        }
+        for(unsigned a=0; a != keys.size(); a++) {
+            for(unsigned b=0; b != keys.size(); b++) {
+                shares_output[keys[a]][keys[b]] = true;
+            }
+        }
+    }
+}
+
+// mutable_keys[j] is set if key i alone can make the outputs differ while
+// key j is unknown, i.e., the first check of isNonMutable(i, j). only key i
+// is duplicated, so key j is the same node in both copies and all j are
+// checked with the same solver, under different assumptions.
+void tv_solver_t::_findMutableKeys(unsigned i, const std::vector<bool>& shares_output, std::vector<bool>& mutable_keys)
+{
+    using namespace ckt_n;
+    using namespace sat_n;
+
+    node_t* ki = ckt.key_inputs[i];
+    dup_oneKey_t dup(ki);
+    dblckt_t dbl_i(ckt, dup, true);
+
+    index2lit_map_t lmap;
+    sat_n::Solver Si;
+    dbl_i.dbl->split_gates();
+    dbl_i.dbl->init_ternary_solver(Si, lmap);
+
+    node_t* nout = dbl_i.dbl->outputs[0];
+    Lit lout0 = dbl_i.dbl->getTLit0(lmap, nout);
+    Lit lout1 = dbl_i.dbl->getTLit1(lmap, nout);
+
+    _freeze_node(dbl_i, lmap, Si, nout);
+    for(unsigned j=0; j != ckt.num_key_inputs(); j++) {
+        _freeze_node(dbl_i, lmap, Si, dbl_i.getA(ckt.key_inputs[j]));
+        _freeze_node(dbl_i, lmap, Si, dbl_i.getB(ckt.key_inputs[j]));
+    }
+
+    vec_lit_t assumps;
+    assumps.push(~lout0);
+    assumps.push(lout1);
+    _set_node_value(dbl_i, lmap, dbl_i.getA(ki), 0, assumps);
+    _set_node_value(dbl_i, lmap, dbl_i.getB(ki), 1, assumps);
+
+    // the other keys are unconstrained here, which includes them being
+    // unknown. if this is unsat, so are all the checks below.
+    mutable_keys.assign(ckt.num_key_inputs(), false);
+    if(Si.solve(assumps) == false) {
+        return;
+    }
+
+    unsigned base = assumps.size();
+    for(unsigned j=0; j != ckt.num_key_inputs(); j++) {
+        if(j == i) continue;
+        if(!shares_output[j]) {
+            // key j doesn't reach the outputs that key i reaches.
+            mutable_keys[j] = true;
+            continue;
+        }
+        node_t* kj = ckt.key_inputs[j];
+        assert(dbl_i.getA(kj) == dbl_i.getB(kj));
+        _set_node_value(dbl_i, lmap, dbl_i.getA(kj), 2, assumps);
+        mutable_keys[j] = Si.solve(assumps);
+        assumps.shrink(assumps.size() - base);
+    }
+}
+
+int tv_solver_t::countNonMutablePairsParallel(std::ostream& out)
+{
+    int nkeys = ckt.num_key_inputs();
+    out << "keys " << nkeys << std::endl;
+
+    std::vector< std::vector<bool> > shares_output;
+    _keysSharingOutputs(shares_output);
+
+    // a pair is known once both of its keys are done.
+    std::vector< std::vector<bool> > mutable_keys(nkeys);
+    std::vector<bool> done(nkeys, false);
+    int cnt = 0;
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for(int i=0; i < nkeys; i++) {
+        std::vector<bool> mi;
+        _findMutableKeys(i, shares_output[i], mi);
+
+        #pragma omp critical(tvsolver_pairs)
+        {
+            mutable_keys[i].swap(mi);
+            done[i] = true;
+            for(int j=0; j != nkeys; j++) {
+                if(j != i && done[j] && !mutable_keys[i][j] && !mutable_keys[j][i]) {
+                    cnt += 1;
+                    out << std::min(i, j) << " " << std::max(i, j) << std::endl;
+                }
+            }
+        }
+    }
+    return cnt;
+}
+
 void tv_solver_t::qbfSolveSingleKeys(std::vector<std::pair<int, int> >& values)
 {
     using namespace ckt_n;
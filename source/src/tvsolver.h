@@ -20,9 +20,12 @@ private:
     void _init_assumps( sat_n::vec_lit_t& assumps, const std::vector<unsigned>& ks, int vi, int vj); 
     void _extract_inputs(std::vector<bool>& input_values);
     std::pair<int,int> _compare_outputs(std::vector<bool>& output_values);
+    static void _freeze_node(ckt_n::dblckt_t& dbl_in, ckt_n::index2lit_map_t& lit_map, sat_n::Solver& S, ckt_n::node_t* n);
     static void _set_node_value(ckt_n::dblckt_t& dbl_in, ckt_n::index2lit_map_t& lit_map, ckt_n::node_t* n, int val, sat_n::vec_lit_t& assumps);
     int _isolateKeys(const std::vector<unsigned>& keys, int vi, int vj, keyset_list_t& keysets);
     void _freeze_nodes();
+    void _findMutableKeys(unsigned i, const std::vector<bool>& shares_output, std::vector<bool>& mutable_keys);
+    void _keysSharingOutputs(std::vector< std::vector<bool> >& shares_output);
 public:
     tv_solver_t(ckt_n::ckt_t& c, ckt_n::simulator_t& s)
         : ckt(c)
@@ -41,6 +44,11 @@ public:
     void qbfSolveSingleKeys(std::vector<std::pair<int, int> >& values);
     void solveDoubleKeys(keyset_list_t& keysets);
     int countNonMutablePairs(std::ostream& out);
+    // same result, but with one incremental solver per key, pruning of the
+    // pairs that don't share an output, and the keys spread over the
+    // OpenMP threads. pairs are written as soon as they are known, so they
+    // are not sorted.
+    int countNonMutablePairsParallel(std::ostream& out);
     bool isNonMutable(int i, int j);
 };
 #endif